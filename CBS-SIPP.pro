@@ -2,6 +2,7 @@ TEMPLATE = app
 CONFIG += console c++11
 CONFIG -= app_bundle
 CONFIG -= qt
+LIBS += -pthread
 TARGET = CCBS
 INCLUDEPATH += D:/boost_1_73_0
 win32 {
@@ -20,6 +21,10 @@ SOURCES += main.cpp \
     tinyxml2.cpp \
     task.cpp \
     sipp.cpp \
+    path_cache.cpp \
+    thread_pool.cpp \
+    conflict_index.cpp \
+    move_batch.cpp \
     xml_logger.cpp \
     heuristic.cpp
 
@@ -49,5 +54,10 @@ HEADERS += \
     task.h \
     const.h \
     sipp.h \
+    path_cache.h \
+    thread_pool.h \
+    conflict_index.h \
+    move_batch.h \
+    persistent_array.h \
     xml_logger.h \
     heuristic.h
@@ -1,84 +1,82 @@
 #include "cbs.h"
 
+Path CBS::find_path(Agent agent, const Map &map, std::list<Constraint> cons, SIPP &sipp, double max_cost)
+{
+    Path path;
+    auto key = cache.get_key(agent.id, cons);
+    if(cache.find(key, path))
+    {
+        path.expanded = 0;
+        path.pushed = 0;
+        path.popped = 0;
+        path.cached = true;
+        return path;
+    }
+    path = sipp.find_path(agent, map, cons, *h_values, max_cost);
+    if(!path.nodes.empty() || path.cost < 0) //the results of bounded searches that have only proved the lower bound of the cost aren't cached
+        cache.insert(key, path);
+    return path;
+}
+
+double CBS::get_probe_bound(const CBS_Node &node, int agent)
+{
+    //to classify a conflict it's enough to know whether the agent's path becomes more expensive than its current one
+    return config.bounded_probes ? get_cost(node, agent) + CN_EPSILON : CN_INFINITY;
+}
+
 bool CBS::init_root(const Map &map, const Task &task)
 {
     CBS_Node root;
     tree.set_focal_weight(config.focal_weight);
+    root.paths = Persistent_Array<std::shared_ptr<const Path>>(task.get_agents_size());
     Path path;
     for(int i = 0; i < int(task.get_agents_size()); i++)
     {
         Agent agent = task.get_agent(i);
-        path = planner.find_path(agent, map, {}, h_values);
+        path = find_path(agent, map, {}, planners[0]);
         if(path.cost < 0)
             return false;
-        root.paths.push_back(path);
+        root.paths.set(i, std::make_shared<const Path>(path));
         root.cost += path.cost;
     }
     root.low_level_expanded = 0;
     root.parent = nullptr;
     root.cons_num.resize(task.get_agents_size(),0);
+    root.constraints = Persistent_Array<Constraint_List>(task.get_agents_size());
     root.id = 1;
     root.id_str = "1";
-    auto conflicts = get_all_conflicts(root.paths, -1);
+    auto conflicts = get_all_conflicts(root.paths, -1, indexes[0]);
     root.conflicts_num = conflicts.size();
 
     for(auto conflict: conflicts)
         if(!config.use_cardinal)
-            root.conflicts.push_back(conflict);
+            add_conflict(root.conflicts, conflict);
+        else if(config.lazy_classification)
+            root.unclassified_conflicts.push_back(std::make_shared<const Conflict>(conflict));
         else
         {
-            auto pathA = planner.find_path(task.get_agent(conflict.agent1), map, {get_constraint(conflict.agent1, conflict.move1, conflict.move2)}, h_values);
-            auto pathB = planner.find_path(task.get_agent(conflict.agent2), map, {get_constraint(conflict.agent2, conflict.move2, conflict.move1)}, h_values);
-            conflict.path1 = pathA;
-            conflict.path2 = pathB;
-            if(pathA.cost > root.paths[conflict.agent1].cost && pathB.cost > root.paths[conflict.agent2].cost)
+            auto pathA = find_path(task.get_agent(conflict.agent1), map, {get_constraint(conflict.agent1, conflict.move1, conflict.move2)}, planners[0], get_probe_bound(root, conflict.agent1));
+            auto pathB = find_path(task.get_agent(conflict.agent2), map, {get_constraint(conflict.agent2, conflict.move2, conflict.move1)}, planners[0], get_probe_bound(root, conflict.agent2));
+            conflict.path1 = std::make_shared<const Path>(pathA);
+            conflict.path2 = std::make_shared<const Path>(pathB);
+            if(pathA.cost > root.paths[conflict.agent1]->cost && pathB.cost > root.paths[conflict.agent2]->cost)
             {
-                conflict.overcost = std::min(pathA.cost - root.paths[conflict.agent1].cost, pathB.cost - root.paths[conflict.agent2].cost);
-                root.cardinal_conflicts.push_back(conflict);
+                conflict.overcost = std::min(pathA.cost - root.paths[conflict.agent1]->cost, pathB.cost - root.paths[conflict.agent2]->cost);
+                add_conflict(root.cardinal_conflicts, conflict);
             }
-            else if(pathA.cost > root.paths[conflict.agent1].cost || pathB.cost > root.paths[conflict.agent2].cost)
-                root.semicard_conflicts.push_back(conflict);
+            else if(pathA.cost > root.paths[conflict.agent1]->cost || pathB.cost > root.paths[conflict.agent2]->cost)
+                add_conflict(root.semicard_conflicts, conflict);
             else
-                root.conflicts.push_back(conflict);
+                add_conflict(root.conflicts, conflict);
         }
     solution.init_cost = root.cost;
-    tree.add_node(root);
+    tree.add_node(std::move(root));
     return true;
 }
 
 bool CBS::check_conflict(Move move1, Move move2)
 {
-    double startTimeA(move1.t1), endTimeA(move1.t2), startTimeB(move2.t1), endTimeB(move2.t2);
-    Vector2D A(move1.i1, move1.j1);
-    Vector2D B(move2.i1, move2.j1);
-    Vector2D VA((move1.i2 - move1.i1)/(move1.t2 - move1.t1), (move1.j2 - move1.j1)/(move1.t2 - move1.t1));
-    Vector2D VB((move2.i2 - move2.i1)/(move2.t2 - move2.t1), (move2.j2 - move2.j1)/(move2.t2 - move2.t1));
-    if(startTimeB > startTimeA)
-    {
-        A += VA*(startTimeB-startTimeA);
-        startTimeA = startTimeB;
-    }
-    else if(startTimeB < startTimeA)
-    {
-        B += VB*(startTimeA - startTimeB);
-        startTimeB = startTimeA;
-    }
-    double r(2*CN_AGENT_SIZE);
-    Vector2D w(B - A);
-    double c(w*w - r*r);
-    if(c < 0)
-        return true;
-
-    Vector2D v(VA - VB);
-    double a(v*v);
-    double b(w*v);
-    double dscr(b*b - a*c);
-    if(dscr - CN_EPSILON < 0)
-        return false;
-    double ctime = (b - sqrt(dscr))/a;
-    if(ctime > -CN_EPSILON && ctime < std::min(endTimeB,endTimeA) - startTimeA + CN_EPSILON)
-        return true;
-    return false;
+    return Move_Batch::check_pair(move1, move2);
 }
 
 Constraint CBS::get_wait_constraint(int agent, Move move1, Move move2)
@@ -133,28 +131,28 @@ Constraint CBS::get_wait_constraint(int agent, Move move1, Move move2)
     return Constraint(agent, interval.first, interval.second, move1.i1, move1.j1, move1.i2, move1.j2, move1.id1, move1.id2);
 }
 
-double CBS::get_hl_heuristic(const std::list<Conflict> &conflicts)
+double CBS::get_hl_heuristic(const Conflict_List &conflicts)
 {
-    if(conflicts.empty() || CN_HLH_TYPE == 0)
+    if(conflicts.empty() || config.hlh_type == 0)
         return 0;
-    else if (CN_HLH_TYPE == 1)
+    else if (config.hlh_type == 1)
     {
         optimization::Simplex simplex("simplex");
         std::map<int, int> colliding_agents;
-        for(auto c: conflicts)
+        for(auto& c: conflicts)
         {
-            colliding_agents.insert({c.agent1, colliding_agents.size()});
-            colliding_agents.insert({c.agent2, colliding_agents.size()});
+            colliding_agents.insert({c->agent1, colliding_agents.size()});
+            colliding_agents.insert({c->agent2, colliding_agents.size()});
         }
 
         pilal::Matrix coefficients(conflicts.size(), colliding_agents.size(), 0);
         std::vector<double> overcosts(conflicts.size());
         int i(0);
-        for(auto c:conflicts)
+        for(auto& c:conflicts)
         {
-            coefficients.at(i, colliding_agents.at(c.agent1)) = 1;
-            coefficients.at(i, colliding_agents.at(c.agent2)) = 1;
-            overcosts[i] = c.overcost;
+            coefficients.at(i, colliding_agents.at(c->agent1)) = 1;
+            coefficients.at(i, colliding_agents.at(c->agent2)) = 1;
+            overcosts[i] = c->overcost;
             i++;
         }
         simplex.set_problem(coefficients, overcosts);
@@ -167,8 +165,8 @@ double CBS::get_hl_heuristic(const std::list<Conflict> &conflicts)
         std::vector<std::tuple<double, int, int>> values;
         values.reserve(conflicts.size());
         std::set<int> used;
-        for(auto c:conflicts)
-            values.push_back(std::make_tuple(c.overcost, c.agent1, c.agent2));
+        for(auto& c:conflicts)
+            values.push_back(std::make_tuple(c->overcost, c->agent1, c->agent2));
         std::sort(values.begin(), values.end(), std::greater<std::tuple<double, int, int>>());
         for(auto v: values)
         {
@@ -186,221 +184,487 @@ Constraint CBS::get_constraint(int agent, Move move1, Move move2)
 {
     if(move1.id1 == move1.id2)
         return get_wait_constraint(agent, move1, move2);
-    double startTimeA(move1.t1), endTimeA(move1.t2);
-    Vector2D A(move1.i1, move1.j1), A2(move1.i2, move1.j2), B(move2.i1, move2.j1), B2(move2.i2, move2.j2);
     if(move2.t2 == CN_INFINITY)
         return Constraint(agent, move1.t1, CN_INFINITY, move1.i1, move1.j1, move1.i2, move1.j2, move1.id1, move1.id2);
+    double end;
+    if(config.interval_mode == 0)
+        end = get_unsafe_end_bisection(move1, move2);
+    else
+    {
+        end = get_unsafe_end(move1, move2);
+        if(config.interval_mode == 2)
+        {
+            double check = get_unsafe_end_bisection(move1, move2);
+            if(fabs(check - end) > 2*config.precision)
+                std::cout<<"Warning! The end of the unsafe interval differs from the one found by bisection: "<<end<<" vs "<<check<<"."<<std::endl;
+        }
+    }
+    return Constraint(agent, move1.t1, end, move1.i1, move1.j1, move1.i2, move1.j2, move1.id1, move1.id2);
+}
+
+void CBS::update_unsafe_end(Vector2D p, Vector2D q, double lo, double hi, double &end)
+{
+    //looks for the max s from [lo, hi] such that |p + q*s| < r
+    double r = 2*CN_AGENT_SIZE;
+    double a = q*q, b = p*q, c = p*p - r*r;
+    if(hi < lo || hi <= end)
+        return;
+    if(a < CN_EPSILON)
+    {
+        if(c < 0)
+            end = hi;
+        return;
+    }
+    double dscr = b*b - a*c;
+    if(dscr <= 0)
+        return;
+    double s1 = (-b - sqrt(dscr))/a, s2 = (-b + sqrt(dscr))/a;
+    if(s1 < hi && s2 > lo)
+        end = std::max(end, std::min(s2, hi));
+}
+
+double CBS::get_unsafe_end(const Move &move1, const Move &move2)
+{
+    //if the first agent starts its move at time s, the distance between the agents at time t is |c0 + u*t + v*s|;
+    //the pairs (t, s) such that it is less than r and t belongs to both moves form a convex set, so the unsafe start times form an interval,
+    //and its end is the max s of this set, that lies either on a side of the parallelogram of valid (t, s) or at the top of the ellipse
+    double durationA(move1.t2 - move1.t1), durationB(move2.t2 - move2.t1);
+    Vector2D VA((move1.i2 - move1.i1)/durationA, (move1.j2 - move1.j1)/durationA);
+    Vector2D VB(durationB > 0 ? (move2.i2 - move2.i1)/durationB : 0, durationB > 0 ? (move2.j2 - move2.j1)/durationB : 0);
+    Vector2D c0 = Vector2D(move1.i1 - move2.i1, move1.j1 - move2.j1) + VB*move2.t1;
+    Vector2D u(VA - VB), v(-VA), uv(u + v);
+    double end(-CN_INFINITY);
+    update_unsafe_end(c0, uv, move2.t1, move2.t2, end);//t = s
+    update_unsafe_end(c0 + u*durationA, uv, move2.t1 - durationA, move2.t2 - durationA, end);//t = s + durationA
+    update_unsafe_end(c0 + u*move2.t1, v, move2.t1 - durationA, move2.t1, end);//t = move2.t1
+    update_unsafe_end(c0 + u*move2.t2, v, move2.t2 - durationA, move2.t2, end);//t = move2.t2
+    double det = u.i*v.j - u.j*v.i;
+    if(fabs(det) > CN_EPSILON)
+    {
+        Vector2D row_t(v.j/det, -v.i/det), row_s(-u.j/det, u.i/det);
+        double norm = sqrt(row_s*row_s);
+        Vector2D y = row_s*(2*CN_AGENT_SIZE/norm) - c0;
+        double t(row_t*y), s(row_s*y);
+        if(s > end && t > s - CN_EPSILON && t < s + durationA + CN_EPSILON && t > move2.t1 - CN_EPSILON && t < move2.t2 + CN_EPSILON)
+            end = s;
+    }
+    end = std::min(std::max(end, move1.t1), move2.t2);
+    //when the agents just graze each other, check_conflict may still find a collision within its tolerance, then the rest is found by bisection
+    Move shifted(end, end + durationA, move1.i1, move1.j1, move1.i2, move1.j2, move1.id1, move1.id2);
+    if(end < move2.t2 && check_conflict(shifted, move2))
+        end = get_unsafe_end_bisection(shifted, move2);
+    return end;
+}
+
+double CBS::get_unsafe_end_bisection(Move move1, const Move &move2)
+{
+    double startTimeA(move1.t1), endTimeA(move1.t2);
     double delta = move2.t2 - move1.t1;
+    //the current position and both positions the next step can lead to are checked in one batch, so the batch serves two steps of bisection
+    Move_Batch batch;
+    int collides(-1), collides_later(-1), collides_earlier(-1);
     while(delta > config.precision/2.0)
     {
-        if(check_conflict(move1, move2))
+        if(collides < 0)
+        {
+            batch.clear();
+            batch.add(move1, move2);
+            batch.add(Move(move1.t1 + delta, move1.t2 + delta, move1.i1, move1.j1, move1.i2, move1.j2), move2);
+            batch.add(Move(move1.t1 - delta, move1.t2 - delta, move1.i1, move1.j1, move1.i2, move1.j2), move2);
+            unsigned int mask = batch.check();
+            collides = mask & 1;
+            collides_later = (mask >> 1) & 1;
+            collides_earlier = (mask >> 2) & 1;
+        }
+        if(collides)
         {
             move1.t1 += delta;
             move1.t2 += delta;
+            collides = collides_later;
         }
         else
         {
             move1.t1 -= delta;
             move1.t2 -= delta;
+            collides = collides_earlier;
         }
+        collides_later = collides_earlier = -1;
         if(move1.t1 > move2.t2 + CN_EPSILON)
         {
             move1.t1 = move2.t2;
             move1.t2 = move1.t1 + endTimeA - startTimeA;
+            collides = -1;
             break;
         }
         delta /= 2.0;
     }
-    if(delta < config.precision/2.0 + CN_EPSILON && check_conflict(move1, move2))
+    if(delta < config.precision/2.0 + CN_EPSILON && (collides < 0 ? check_conflict(move1, move2) : collides == 1))
     {
         move1.t1 = fmin(move1.t1 + delta*2, move2.t2);
         move1.t2 = move1.t1 + endTimeA - startTimeA;
     }
-    return Constraint(agent, startTimeA, move1.t1, move1.i1, move1.j1, move1.i2, move1.j2, move1.id1, move1.id2);
+    return move1.t1;
 }
-Conflict CBS::get_conflict(std::list<Conflict> &conflicts)
+void CBS::add_conflict(Conflict_List &conflicts, const Conflict &conflict)
 {
-    auto best_it = conflicts.begin();
-    for(auto it = conflicts.begin(); it != conflicts.end(); it++)
+    //the new conflict is placed before the equal ones, so among them the earliest added is split on first
+    auto c = std::make_shared<const Conflict>(conflict);
+    conflicts.insert(std::lower_bound(conflicts.begin(), conflicts.end(), c, Conflict_Order()), c);
+}
+
+bool CBS::classify_conflict(CBS_Node &node, Conflict conflict, const Path &path1, const Path &path2, HL_Stats &stats)
+{
+    //path1 and path2 are the paths of the agents found with the constraints that resolve the conflict
+    double cost1 = get_cost(node, conflict.agent1), cost2 = get_cost(node, conflict.agent2);
+    conflict.path1 = std::make_shared<const Path>(path1);
+    conflict.path2 = std::make_shared<const Path>(path2);
+    if(path1.cost < 0 && path2.cost < 0)
+        return false;
+    else if(path1.cost < 0)
     {
-        if(it->overcost > 0)
-        {
-            if(best_it->overcost < it->overcost)
-                best_it = it;
-        }
-        else if(best_it->t < it->t)
-            best_it = it;
+        conflict.overcost = path2.cost - cost2;
+        conflict.type = 1;
+        add_conflict(node.cardinal_conflicts, conflict);
     }
+    else if(path2.cost < 0)
+    {
+        conflict.overcost = path1.cost - cost1;
+        conflict.type = 1;
+        add_conflict(node.cardinal_conflicts, conflict);
+    }
+    else if(path1.cost > cost1 && path2.cost > cost2)
+    {
+        conflict.overcost = std::min(path1.cost - cost1, path2.cost - cost2);
+        add_conflict(node.cardinal_conflicts, conflict);
+    }
+    else if(path1.cost > cost1 || path2.cost > cost2)
+        add_conflict(node.semicard_conflicts, conflict);
+    else
+        add_conflict(node.conflicts, conflict);
+    stats.low_level_searches += int(!path1.cached) + int(!path2.cached);
+    stats.low_level_expanded += (path1.expanded + path2.expanded);
+    stats.low_level_pushed += (path1.pushed + path2.pushed);
+    stats.low_level_popped += (path1.popped + path2.popped);
+    return true;
+}
 
-    Conflict conflict = *best_it;
-    conflicts.erase(best_it);
-    return conflict;
+bool CBS::classify_conflicts(CBS_Node &node, const Map &map, const Task &task, HL_Stats &stats, int thread)
+{
+    //as in ICBS, the classification stops as soon as a cardinal conflict is found; the rest stay unclassified and are passed to the children
+    unsigned int classified = 0;
+    bool solvable = true;
+    while(solvable && node.cardinal_conflicts.empty() && classified < node.unclassified_conflicts.size())
+    {
+        Conflict conflict = *node.unclassified_conflicts[classified++];
+        std::vector<std::list<Constraint>> queries = {get_constraints(&node, conflict.agent1), get_constraints(&node, conflict.agent2)};
+        queries[0].push_back(get_constraint(conflict.agent1, conflict.move1, conflict.move2));
+        queries[1].push_back(get_constraint(conflict.agent2, conflict.move2, conflict.move1));
+        std::vector<Path> paths(2);
+        run_tasks(2, [&](int k, int worker)
+        {
+            int agent = (k == 0 ? conflict.agent1 : conflict.agent2);
+            paths[k] = find_path(task.get_agent(agent), map, queries[k], planners[worker], get_probe_bound(node, agent));
+        }, thread);
+        solvable = classify_conflict(node, conflict, paths[0], paths[1], stats);
+    }
+    node.unclassified_conflicts.erase(node.unclassified_conflicts.begin(), node.unclassified_conflicts.begin() + classified);
+    return solvable;
 }
 
-Solution CBS::find_solution(const Map &map, const Task &task, const Config &cfg)
+bool CBS::expand(CBS_Node &node, CBS_Node *parent, const Map &map, const Task &task, std::vector<CBS_Node> &children, HL_Stats &stats, int thread)
 {
-    config = cfg;
-    h_values.init(map.get_size(), task.get_agents_size());
-    for(int i = 0; i < int(task.get_agents_size()); i++)
+    if(config.use_cardinal && config.lazy_classification && !node.unclassified_conflicts.empty())
     {
-        Agent agent = task.get_agent(i);
-        h_values.count(map, agent);
+        auto time_now = std::chrono::high_resolution_clock::now();
+        bool solvable = classify_conflicts(node, map, task, stats, thread);
+        stats.check_time += std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - time_now).count();
+        if(!solvable)
+            return true;//neither agent of some conflict can resolve it, so the node has no children
     }
-    auto t = std::chrono::high_resolution_clock::now();
-    int cardinal_solved = 0, semicardinal_solved = 0;
-    if(!this->init_root(map, task))
-        return solution;
-    solution.init_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
-    CBS_Node node;
-    std::chrono::duration<double> time_spent;
-    int expanded(1);
-    double time(0);
-    std::list<Conflict> conflicts;
+    if(node.conflicts.empty() && node.semicard_conflicts.empty() && node.cardinal_conflicts.empty())
+        return false; //i.e. no conflicts => solution found
+    //the lists are sorted, so the conflict to split on is the last one of the most important class;
+    //it isn't removed as the children drop all the conflicts of the replanned agents anyway
     Conflict conflict;
-    std::vector<int> conflicting_agents;
-    std::vector<std::pair<int, int>> conflicting_pairs;
-    int low_level_searches(0);
-    int low_level_expanded(0);
-    int id = 2;
-    do
-    {
-        auto parent = tree.get_front();
-        node = *parent;
-        node.cost -= node.h;
-        parent->conflicts.clear();
-        parent->cardinal_conflicts.clear();
-        parent->semicard_conflicts.clear();
-        auto paths = get_paths(&node, task.get_agents_size());
-        auto time_now = std::chrono::high_resolution_clock::now();
-        conflicts = node.conflicts;
-        auto cardinal_conflicts = node.cardinal_conflicts;
-        auto semicard_conflicts = node.semicard_conflicts;
-        time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - time_now);
-        time += time_spent.count();
-        if(conflicts.empty() && semicard_conflicts.empty() && cardinal_conflicts.empty())
+    if(!node.cardinal_conflicts.empty())
+    {
+        conflict = *node.cardinal_conflicts.back();
+        stats.cardinal_solved++;
+    }
+    else if(!node.semicard_conflicts.empty())
+    {
+        conflict = *node.semicard_conflicts.back();
+        stats.semicardinal_solved++;
+    }
+    else
+        conflict = *node.conflicts.back();
+    stats.expanded++;
+    std::list<Constraint> constraintsA = get_constraints(&node, conflict.agent1);
+    Constraint constraintA(get_constraint(conflict.agent1, conflict.move1, conflict.move2));
+    constraintsA.push_back(constraintA);
+    Path pathA = conflict.path1 != nullptr ? *conflict.path1 : Path();
+    std::list<Constraint> constraintsB = get_constraints(&node, conflict.agent2);
+    Constraint constraintB = get_constraint(conflict.agent2, conflict.move2, conflict.move1);
+    constraintsB.push_back(constraintB);
+    Path pathB = conflict.path2 != nullptr ? *conflict.path2 : Path();
+    //the paths found while classifying the conflict are reused, unless a bounded search has found only the lower bound of the cost
+    bool replanA = !config.use_cardinal || (pathA.nodes.empty() && pathA.cost > 0);
+    bool replanB = !config.use_cardinal || (pathB.nodes.empty() && pathB.cost > 0);
+    if(replanA || replanB)
+    {
+        run_tasks(2, [&](int k, int worker)
         {
-            break; //i.e. no conflicts => solution found
-        }
-        if(!cardinal_conflicts.empty())
+            if(k == 0 && replanA)
+                pathA = find_path(task.get_agent(conflict.agent1), map, constraintsA, planners[worker]);
+            else if(k == 1 && replanB)
+                pathB = find_path(task.get_agent(conflict.agent2), map, constraintsB, planners[worker]);
+        }, thread);
+        stats.low_level_searches += int(replanA && !pathA.cached) + int(replanB && !pathB.cached);
+        if(replanA)
         {
-            conflict = get_conflict(cardinal_conflicts);
-            cardinal_solved++;
+            stats.low_level_expanded += pathA.expanded;
+            stats.low_level_pushed += pathA.pushed;
+            stats.low_level_popped += pathA.popped;
         }
-        else if(!semicard_conflicts.empty())
+        if(replanB)
         {
-            conflict = get_conflict(semicard_conflicts);
-            semicardinal_solved++;
+            stats.low_level_expanded += pathB.expanded;
+            stats.low_level_pushed += pathB.pushed;
+            stats.low_level_popped += pathB.popped;
         }
-        else
-            conflict = get_conflict(conflicts);
-        expanded++;
-        std::list<Constraint> constraintsA = get_constraints(&node, conflict.agent1);
-        Constraint constraintA(get_constraint(conflict.agent1, conflict.move1, conflict.move2));
-        constraintsA.push_back(constraintA);
-        Path pathA = conflict.path1;//
-        if(!config.use_cardinal)
+    }
+    CBS_Node right({pathA}, parent, constraintA, node.cost + pathA.cost - get_cost(node, conflict.agent1), node.cons_num, 0, node.look_for_cardinal, node.total_cons);
+    CBS_Node left({pathB}, parent, constraintB, node.cost + pathB.cost - get_cost(node, conflict.agent2), node.cons_num, 0, node.look_for_cardinal, node.total_cons);
+    Constraint positive;
+
+    bool inserted = false;
+    bool left_ok = true, right_ok = true;
+    if(config.use_ds)
+    {
+        int agent1positives(0), agent2positives(0);
+        for(auto c: constraintsA)
+            if(c.positive)
+                agent1positives++;
+        for(auto c: constraintsB)
+            if(c.positive)
+                agent2positives++;
+        if(conflict.move1.id1 != conflict.move1.id2 && agent2positives > agent1positives && pathA.cost > 0)
         {
-            pathA = planner.find_path(task.get_agent(conflict.agent1), map, constraintsA, h_values);
-            low_level_searches++;
-            low_level_expanded += pathA.expanded;
+            positive = Constraint(conflict.agent1, constraintA.t1, constraintA.t2, conflict.move1.i1, conflict.move1.j1, conflict.move1.i2, conflict.move1.j2, conflict.move1.id1, conflict.move1.id2, true);
+            if(check_positive_constraints(constraintsA, positive))
+            {
+                left.positive_constraint = positive;
+                constraintsB.push_back(left.positive_constraint);
+                inserted = true;
+            }
+            //else
+            //    right_ok = false;
         }
-        std::list<Constraint> constraintsB = get_constraints(&node, conflict.agent2);
-        Constraint constraintB = get_constraint(conflict.agent2, conflict.move2, conflict.move1);
-        constraintsB.push_back(constraintB);
-        Path pathB = conflict.path2;
-        if(!config.use_cardinal)
+        if(conflict.move2.id1 != conflict.move2.id2 && !inserted && pathB.cost > 0)
         {
-            pathB = planner.find_path(task.get_agent(conflict.agent2), map, constraintsB, h_values);
-            low_level_searches++;
-            low_level_expanded += pathB.expanded;
-        }
-        CBS_Node right({pathA}, parent, constraintA, node.cost + pathA.cost - get_cost(node, conflict.agent1), node.cons_num, 0, node.look_for_cardinal, node.total_cons);
-        CBS_Node left({pathB}, parent, constraintB, node.cost + pathB.cost - get_cost(node, conflict.agent2), node.cons_num, 0, node.look_for_cardinal, node.total_cons);
-        Constraint positive;
-
-        bool inserted = false;
-        bool left_ok = true, right_ok = true;
-        if(CN_USE_DS)
-        {
-            int agent1positives(0), agent2positives(0);
-            for(auto c: constraintsA)
-                if(c.positive)
-                    agent1positives++;
-            for(auto c: constraintsB)
-                if(c.positive)
-                    agent2positives++;
-            if(conflict.move1.id1 != conflict.move1.id2 && agent2positives > agent1positives && pathA.cost > 0)
+            positive = Constraint(conflict.agent2, constraintB.t1, constraintB.t2, conflict.move2.i1, conflict.move2.j1, conflict.move2.i2, conflict.move2.j2, conflict.move2.id1, conflict.move2.id2, true);
+            if(check_positive_constraints(constraintsB, positive))
             {
-                positive = Constraint(conflict.agent1, constraintA.t1, constraintA.t2, conflict.move1.i1, conflict.move1.j1, conflict.move1.i2, conflict.move1.j2, conflict.move1.id1, conflict.move1.id2, true);
-                if(check_positive_constraints(constraintsA, positive))
-                {
-                    left.positive_constraint = positive;
-                    constraintsB.push_back(left.positive_constraint);
-                    inserted = true;
-                }
-                //else
-                //    right_ok = false;
+                right.positive_constraint = positive;
+                constraintsA.push_back(right.positive_constraint);
+                inserted = true;
             }
-            if(conflict.move2.id1 != conflict.move2.id2 && !inserted && pathB.cost > 0)
+            //else
+            //    left_ok = false;
+        }
+        if(conflict.move1.id1 != conflict.move1.id2 && !inserted && pathA.cost > 0)
+        {
+            positive = Constraint(conflict.agent1, constraintA.t1, constraintA.t2, conflict.move1.i1, conflict.move1.j1, conflict.move1.i2, conflict.move1.j2, conflict.move1.id1, conflict.move1.id2, true);
+            if(check_positive_constraints(constraintsA, positive))
             {
-                positive = Constraint(conflict.agent2, constraintB.t1, constraintB.t2, conflict.move2.i1, conflict.move2.j1, conflict.move2.i2, conflict.move2.j2, conflict.move2.id1, conflict.move2.id2, true);
-                if(check_positive_constraints(constraintsB, positive))
-                {
-                    right.positive_constraint = positive;
-                    constraintsA.push_back(right.positive_constraint);
-                    inserted = true;
-                }
-                //else
-                //    left_ok = false;
+                inserted = true;
+                left.positive_constraint = positive;
+                constraintsB.push_back(left.positive_constraint);
             }
-            if(conflict.move1.id1 != conflict.move1.id2 && !inserted && pathA.cost > 0)
+            //else
+            //    right_ok = false;
+        }
+    }
+    right.id_str = node.id_str + "0";
+    left.id_str = node.id_str + "1";
+    right.id = next_id++;
+    left.id = next_id++;
+    right.inherit_constraints(node);
+    left.inherit_constraints(node);
+    std::vector<CBS_Node*> new_nodes;
+    std::vector<Path> new_paths;
+    if(right_ok && pathA.cost > 0 && validate_constraints(constraintsA, pathA.agentID))
+    {
+        new_nodes.push_back(&right);
+        new_paths.push_back(pathA);
+    }
+    if(left_ok && pathB.cost > 0 && validate_constraints(constraintsB, pathB.agentID))
+    {
+        new_nodes.push_back(&left);
+        new_paths.push_back(pathB);
+    }
+    //both children are built at once: the pool looks for their conflicts and then for all the paths needed to classify them,
+    //while the classification itself and the order of the children stay fixed
+    auto time_now = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<Conflict>> new_conflicts(new_nodes.size());
+    run_tasks(int(new_nodes.size()), [&](int k, int worker)
+    {
+        new_conflicts[k] = get_all_conflicts(new_nodes[k]->paths, new_paths[k].agentID, indexes[worker]);
+    }, thread);
+    std::vector<int> agents;
+    std::vector<std::list<Constraint>> queries;
+    std::vector<double> bounds;
+    std::vector<unsigned int> offsets;
+    for(unsigned int k = 0; k < new_nodes.size(); k++)
+    {
+        offsets.push_back(agents.size());
+        if(config.use_cardinal && !config.lazy_classification)
+            get_queries(*new_nodes[k], new_paths[k], new_conflicts[k], agents, queries, bounds);
+    }
+    std::vector<Path> query_paths(agents.size());
+    run_tasks(int(agents.size()), [&](int k, int worker)
+    {
+        query_paths[k] = find_path(task.get_agent(agents[k]), map, queries[k], planners[worker], bounds[k]);
+    }, thread);
+    for(unsigned int k = 0; k < new_nodes.size(); k++)
+    {
+        find_new_conflicts(*new_nodes[k], new_paths[k], node.conflicts, node.semicard_conflicts, node.cardinal_conflicts, node.unclassified_conflicts,
+                           new_conflicts[k], query_paths, offsets[k], stats);
+        if(new_nodes[k]->cost > 0)
+        {
+            new_nodes[k]->h = get_hl_heuristic(new_nodes[k]->cardinal_conflicts);
+            new_nodes[k]->cost += new_nodes[k]->h;
+            children.push_back(std::move(*new_nodes[k]));
+        }
+    }
+    auto time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - time_now);
+    stats.check_time += time_spent.count();
+    return true;
+}
+
+void CBS::run_tasks(int tasks, std::function<void(int, int)> task, int thread)
+{
+    if(thread < 0)
+        pool.run(tasks, task);
+    else //the calling thread is a worker of the parallel high-level search, so it does all the job by itself
+        for(int k = 0; k < tasks; k++)
+            task(k, thread);
+}
+
+bool CBS::parallel_search(const Map &map, const Task &task, CBS_Node &node, HL_Stats &stats, std::chrono::high_resolution_clock::time_point start)
+{
+    //each thread of the pool expands its own nodes; the search stops when no open or currently expanded node can lead to a solution cheaper than the incumbent
+    std::mutex mutex;
+    std::condition_variable cv;
+    int busy(0);
+    bool done(false), found(false);
+    std::vector<double> bounds(pool.get_size(), CN_INFINITY);//costs of the nodes that are being expanded
+    std::vector<HL_Stats> thread_stats(pool.get_size());
+    pool.run(pool.get_size(), [&](int, int thread)
+    {
+        std::vector<CBS_Node> children;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            cv.wait(lock, [&]{ return done || tree.get_open_size() > 0 || busy == 0; });
+            if(done)
+                break;
+            double lower_bound = tree.get_min_cost();
+            for(auto b: bounds)
+                lower_bound = std::min(lower_bound, b);
+            auto time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start);
+            if(tree.get_open_size() == 0 || (found && node.cost < lower_bound*config.focal_weight + CN_EPSILON) || time_spent.count() > config.timelimit || is_cancelled())
             {
-                positive = Constraint(conflict.agent1, constraintA.t1, constraintA.t2, conflict.move1.i1, conflict.move1.j1, conflict.move1.i2, conflict.move1.j2, conflict.move1.id1, conflict.move1.id2, true);
-                if(check_positive_constraints(constraintsA, positive))
-                {
-                    inserted = true;
-                    left.positive_constraint = positive;
-                    constraintsB.push_back(left.positive_constraint);
-                }
-                //else
-                //    right_ok = false;
+                done = true;
+                cv.notify_all();
+                break;
             }
-        }
-        right.id_str = node.id_str + "0";
-        left.id_str = node.id_str + "1";
-        right.id = id++;
-        left.id = id++;
-        if(right_ok && pathA.cost > 0 && validate_constraints(constraintsA, pathA.agentID))
-        {
-            time_now = std::chrono::high_resolution_clock::now();
-            find_new_conflicts(map, task, right, paths, pathA, conflicts, semicard_conflicts, cardinal_conflicts, low_level_searches, low_level_expanded);
-            time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - time_now);
-            time += time_spent.count();
-            if(right.cost > 0)
+            CBS_Node cur;
+            auto parent = tree.pop_front(cur);
+            cur.cost -= cur.h;
+            if(found && cur.cost > node.cost - CN_EPSILON)
+                continue;
+            if(!found)
+                node = cur;
+            busy++;
+            bounds[thread] = cur.cost;
+            lock.unlock();
+            children.clear();
+            bool has_conflicts = expand(cur, parent, map, task, children, thread_stats[thread], thread);
+            lock.lock();
+            busy--;
+            bounds[thread] = CN_INFINITY;
+            if(!has_conflicts)
             {
-                right.h = get_hl_heuristic(right.cardinal_conflicts);
-                right.cost += right.h;
-                tree.add_node(right);
+                if(!found || cur.cost < node.cost)
+                    node = cur;
+                found = true;
             }
+            for(auto& child: children)
+                if(!found || child.cost < node.cost - CN_EPSILON)
+                    tree.add_node(std::move(child));
+            cv.notify_all();
         }
-        if(left_ok && pathB.cost > 0 && validate_constraints(constraintsB, pathB.agentID))
+    });
+    for(auto& s: thread_stats)
+        stats += s;
+    return found;
+}
+
+Solution CBS::find_solution(const Map &map, const Task &task, const Config &cfg, const Heuristic *shared_heuristic, const std::atomic<bool> *cancel)
+{
+    config = cfg;
+    cancelled = cancel;
+    pool.init(config.threads);
+    planners.resize(pool.get_size());
+    for(auto& p: planners)
+        p.set_incremental(config.use_incremental);
+    indexes.assign(pool.get_size(), Conflict_Index());
+    for(auto& index: indexes)
+        index.init(std::max(config.agent_size, double(CN_AGENT_SIZE)), task.get_agents_size());
+    cache.clear();
+    cache.set_capacity(config.cache_size);
+    auto init_start = std::chrono::high_resolution_clock::now();//the initialization includes counting the heuristic, but the time limit applies only to the search
+    if(shared_heuristic != nullptr)
+        h_values = shared_heuristic;
+    else
+    {
+        heuristic.init(map.get_size(), config.h_storage, config.pivots, config.lazy_heuristic);
+        heuristic.count(map, task, pool);
+        h_values = &heuristic;
+    }
+    auto t = std::chrono::high_resolution_clock::now();
+    if(!this->init_root(map, task))
+        return solution;
+    solution.init_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - init_start);
+    CBS_Node node;
+    std::chrono::duration<double> time_spent;
+    HL_Stats stats;
+    stats.expanded = 1;
+    next_id = 2;
+    if(config.parallel_hl && pool.get_size() > 1)
+        solution.found = parallel_search(map, task, node, stats, t);
+    else
+    {
+        std::vector<CBS_Node> children;
+        do
         {
-            time_now = std::chrono::high_resolution_clock::now();
-            find_new_conflicts(map, task, left, paths, pathB, conflicts, semicard_conflicts, cardinal_conflicts, low_level_searches, low_level_expanded);
-            time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - time_now);
-            time += time_spent.count();           
-            if(left.cost > 0)
+            auto parent = tree.pop_front(node);
+            node.cost -= node.h;
+            children.clear();
+            if(!expand(node, parent, map, task, children, stats))
             {
-                left.h = get_hl_heuristic(left.cardinal_conflicts);
-                left.cost += left.h;
-                tree.add_node(left);
+                solution.found = true;
+                break;
             }
+            for(auto& child: children)
+                tree.add_node(std::move(child));
+            time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
+            if(time_spent.count() > config.timelimit || is_cancelled())
+                break;
         }
-        time_spent = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
-        if(time_spent.count() > config.timelimit)
-            break;
+        while(tree.get_open_size() > 0);
     }
-    while(tree.get_open_size() > 0);
     solution.paths = get_paths(&node, task.get_agents_size());
     solution.flowtime = node.cost;
     for(auto i:node.cons_num)
@@ -409,16 +673,20 @@ Solution CBS::find_solution(const Map &map, const Task &task, const Config &cfg)
         if(solution.max_constraints < i)
             solution.max_constraints = i;
     }
-    solution.low_level_expansions = low_level_searches;
-    solution.low_level_expanded = double(low_level_expanded)/std::max(low_level_searches, 1);
-    solution.high_level_expanded = expanded;
+    solution.low_level_expansions = stats.low_level_searches;
+    solution.low_level_expanded = double(stats.low_level_expanded)/std::max(stats.low_level_searches, 1);
+    solution.low_level_pushed = stats.low_level_pushed/std::max(stats.low_level_searches, 1);
+    solution.low_level_popped = stats.low_level_popped/std::max(stats.low_level_searches, 1);
+    solution.cache_hit_rate = cache.get_hit_rate();
+    solution.high_level_expanded = stats.expanded;
     solution.high_level_generated = int(tree.get_size());
+    solution.memory_per_node = tree.get_memory_per_node();
     for(auto path:solution.paths)
         solution.makespan = (solution.makespan > path.cost) ? solution.makespan : path.cost;
     solution.time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - t);
-    solution.check_time = time;
-    solution.cardinal_solved = cardinal_solved;
-    solution.semicardinal_solved = semicardinal_solved;
+    solution.check_time = stats.check_time;
+    solution.cardinal_solved = stats.cardinal_solved;
+    solution.semicardinal_solved = stats.semicardinal_solved;
     return solution;
 }
 
@@ -494,128 +762,88 @@ bool CBS::validate_constraints(std::list<Constraint> constraints, int agent)
     return true;
 }
 
-void CBS::find_new_conflicts(const Map &map, const Task &task, CBS_Node &node, std::vector<Path> paths, Path path,
-                             std::list<Conflict> conflicts, std::list<Conflict> semicard_conflicts, std::list<Conflict> cardinal_conflicts,
-                             int &low_level_searches, int &low_level_expanded)
+void CBS::get_queries(CBS_Node &node, const Path &path, const std::vector<Conflict> &new_conflicts,
+                      std::vector<int> &agents, std::vector<std::list<Constraint>> &constraints, std::vector<double> &bounds)
 {
-    paths[path.agentID] = path;
-    auto new_conflicts = get_all_conflicts(paths, path.agentID);
-    std::list<Conflict> conflictsA({}), semicard_conflictsA({}), cardinal_conflictsA({});
-    for(auto c: conflicts)
-        if(c.agent1 != path.agentID && c.agent2 != path.agentID)
-            conflictsA.push_back(c);
-    for(auto c: semicard_conflicts)
-        if(c.agent1 != path.agentID && c.agent2 != path.agentID)
-            semicard_conflictsA.push_back(c);
-    for(auto c: cardinal_conflicts)
-        if(c.agent1 != path.agentID && c.agent2 != path.agentID)
-            cardinal_conflictsA.push_back(c);
-    if(!config.use_cardinal)
-    {
-        node.conflicts = conflictsA;
-        for(auto n:new_conflicts)
-            node.conflicts.push_back(n);
-        node.cardinal_conflicts.clear();
-        node.semicard_conflicts.clear();
-        node.conflicts_num = node.conflicts.size();
-        return;
-    }
     for(auto c: new_conflicts)
     {
-        std::list<Constraint> constraintsA, constraintsB;
-        if(path.agentID == c.agent1)
-        {
-            constraintsA = get_constraints(&node, c.agent1);
-            constraintsA.push_back(get_constraint(c.agent1, c.move1, c.move2));
-            auto new_pathA = planner.find_path(task.get_agent(c.agent1), map, constraintsA, h_values);
-            constraintsB = get_constraints(&node, c.agent2);
-            constraintsB.push_back(get_constraint(c.agent2, c.move2, c.move1));
-            auto new_pathB = planner.find_path(task.get_agent(c.agent2), map, constraintsB, h_values);
-            double old_cost = get_cost(node, c.agent2);
-            c.path1 = new_pathA;
-            c.path2 = new_pathB;
-            if(new_pathA.cost < 0 && new_pathB.cost < 0)
-            {
-                node.cost = -1;
-                return;
-            }
-            else if (new_pathA.cost < 0)
-            {
-                c.overcost = new_pathB.cost - old_cost;
-                c.type = 1;
-                cardinal_conflictsA.push_back(c);
-            }
-            else if (new_pathB.cost < 0)
-            {
-                c.overcost = new_pathA.cost - path.cost;
-                c.type = 1;
-                cardinal_conflictsA.push_back(c);
-            }
-            else if(new_pathA.cost > path.cost && new_pathB.cost > old_cost)
-            {
-                c.overcost = std::min(new_pathA.cost - path.cost, new_pathB.cost - old_cost);
-                cardinal_conflictsA.push_back(c);
-            }
-            else if(new_pathA.cost > path.cost || new_pathB.cost > old_cost)
-                semicard_conflictsA.push_back(c);
-            else
-                conflictsA.push_back(c);
-            low_level_searches += 2;
-            low_level_expanded += (new_pathA.expanded + new_pathB.expanded);
+        int agentA(c.agent1), agentB(c.agent2);
+        Constraint constraintA(get_constraint(c.agent1, c.move1, c.move2)), constraintB(get_constraint(c.agent2, c.move2, c.move1));
+        if(path.agentID != c.agent1)
+        {
+            std::swap(agentA, agentB);
+            std::swap(constraintA, constraintB);
         }
-        else
+        agents.push_back(agentA);
+        constraints.push_back(get_constraints(&node, agentA));
+        constraints.back().push_back(constraintA);
+        bounds.push_back(get_probe_bound(node, agentA));
+        agents.push_back(agentB);
+        constraints.push_back(get_constraints(&node, agentB));
+        constraints.back().push_back(constraintB);
+        bounds.push_back(get_probe_bound(node, agentB));
+    }
+}
+
+void CBS::find_new_conflicts(CBS_Node &node, const Path &path, const Conflict_List &conflicts, const Conflict_List &semicard_conflicts, const Conflict_List &cardinal_conflicts,
+                             const Conflict_List &unclassified_conflicts, const std::vector<Conflict> &new_conflicts, const std::vector<Path> &new_paths, unsigned int offset, HL_Stats &stats)
+{
+    //the conflicts of the other agents are shared with the parent, only the pointers are copied
+    node.conflicts.clear();
+    node.semicard_conflicts.clear();
+    node.cardinal_conflicts.clear();
+    node.unclassified_conflicts.clear();
+    for(auto& c: conflicts)
+        if(c->agent1 != path.agentID && c->agent2 != path.agentID)
+            node.conflicts.push_back(c);
+    for(auto& c: semicard_conflicts)
+        if(c->agent1 != path.agentID && c->agent2 != path.agentID)
+            node.semicard_conflicts.push_back(c);
+    for(auto& c: cardinal_conflicts)
+        if(c->agent1 != path.agentID && c->agent2 != path.agentID)
+            node.cardinal_conflicts.push_back(c);
+    for(auto& c: unclassified_conflicts)
+        if(c->agent1 != path.agentID && c->agent2 != path.agentID)
+            node.unclassified_conflicts.push_back(c);
+    if(!config.use_cardinal || config.lazy_classification)
+    {
+        for(auto n:new_conflicts)
         {
-            constraintsA = get_constraints(&node, c.agent2);
-            constraintsA.push_back(get_constraint(c.agent2, c.move2, c.move1));
-            auto new_pathA = planner.find_path(task.get_agent(c.agent2), map, constraintsA, h_values);
-            constraintsB = get_constraints(&node, c.agent1);
-            constraintsB.push_back(get_constraint(c.agent1, c.move1, c.move2));
-            auto new_pathB = planner.find_path(task.get_agent(c.agent1), map, constraintsB, h_values);
-            double old_cost = get_cost(node, c.agent1);
-            c.path1 = new_pathB;
-            c.path2 = new_pathA;
-            if(new_pathA.cost < 0 && new_pathB.cost < 0)
-            {
-                node.cost = -1;
-                return;
-            }
-            else if (new_pathA.cost < 0)
-            {
-                c.overcost = new_pathB.cost - old_cost;
-                c.type = 1;
-                cardinal_conflictsA.push_back(c);
-            }
-            else if (new_pathB.cost < 0)
-            {
-                c.overcost = new_pathA.cost - path.cost;
-                c.type = 1;
-                cardinal_conflictsA.push_back(c);
-            }
-            else if(new_pathA.cost > path.cost && new_pathB.cost > old_cost)
-            {
-                c.overcost = std::min(new_pathA.cost - path.cost, new_pathB.cost - old_cost);
-                cardinal_conflictsA.push_back(c);
-            }
-            else if(new_pathA.cost > path.cost || new_pathB.cost > old_cost)
-                semicard_conflictsA.push_back(c);
+            if(config.use_cardinal)
+                node.unclassified_conflicts.push_back(std::make_shared<const Conflict>(n));
             else
-                conflictsA.push_back(c);
-            low_level_searches += 2;
-            low_level_expanded += (new_pathA.expanded + new_pathB.expanded);
+                add_conflict(node.conflicts, n);
         }
+        node.conflicts_num = node.conflicts.size() + node.semicard_conflicts.size() + node.cardinal_conflicts.size() + node.unclassified_conflicts.size();
+        return;
     }
-
-    node.conflicts = conflictsA;
-    node.semicard_conflicts = semicard_conflictsA;
-    node.cardinal_conflicts = cardinal_conflictsA;
-    node.conflicts_num = conflictsA.size() + semicard_conflictsA.size() + cardinal_conflictsA.size();
-    return;
+    //new_paths are the paths found for the queries made by get_queries, they start from the offset
+    for(unsigned int k = 0; k < new_conflicts.size(); k++)
+    {
+        const Conflict &c = new_conflicts[k];
+        const Path &new_pathA = new_paths[offset + 2*k];//the path of the replanned agent
+        const Path &new_pathB = new_paths[offset + 2*k + 1];
+        bool solvable = (path.agentID == c.agent1) ? classify_conflict(node, c, new_pathA, new_pathB, stats)
+                                                   : classify_conflict(node, c, new_pathB, new_pathA, stats);
+        if(!solvable)
+        {
+            node.cost = -1;
+            return;
+        }
+    }
+    node.conflicts_num = node.conflicts.size() + node.semicard_conflicts.size() + node.cardinal_conflicts.size();
 }
 
 std::list<Constraint> CBS::get_constraints(CBS_Node *node, int agent_id)
 {
-    CBS_Node* curNode = node;
     std::list<Constraint> constraints(0);
+    if(agent_id >= 0)
+    {
+        for(auto cell = node->constraints[agent_id]; cell != nullptr; cell = cell->next)
+            constraints.push_back(cell->constraint);
+        return constraints;
+    }
+    CBS_Node* curNode = node;
     while(curNode->parent != nullptr)
     {
         if(agent_id < 0 || curNode->constraint.agent == agent_id)
@@ -628,31 +856,50 @@ std::list<Constraint> CBS::get_constraints(CBS_Node *node, int agent_id)
 }
 
 
-Conflict CBS::check_paths(Path pathA, Path pathB)
+Conflict CBS::check_paths(const Path &pathA, const Path &pathB)
 {
     unsigned int a(0), b(0);
-    std::vector<Node> nodesA = pathA.nodes;
-    std::vector<Node> nodesB = pathB.nodes;
+    const std::vector<Node> &nodesA = pathA.nodes;
+    const std::vector<Node> &nodesB = pathB.nodes;
+    //the pairs of moves that pass the distance test are checked in batches, the first colliding pair in the order of the sweep is returned
+    Move_Batch batch;
+    Move movesA[Move_Batch::capacity], movesB[Move_Batch::capacity];
     while(a < nodesA.size() - 1 || b < nodesB.size() - 1)
     {
         if(a < nodesA.size() - 1 && b < nodesB.size() - 1) // if both agents have not reached their goals yet
         {
             if(sqrt(pow(nodesA[a].i - nodesB[b].i, 2) + pow(nodesA[a].j - nodesB[b].j, 2) - CN_EPSILON)
                     < (nodesA[a+1].g - nodesA[a].g) + (nodesB[b+1].g - nodesB[b].g))
-                if(check_conflict(Move(nodesA[a], nodesA[a+1]), Move(nodesB[b], nodesB[b+1])))
-                    return Conflict(pathA.agentID, pathB.agentID, Move(nodesA[a], nodesA[a+1]), Move(nodesB[b], nodesB[b+1]), std::min(nodesA[a].g, nodesB[b].g));
+            {
+                movesA[batch.size()] = Move(nodesA[a], nodesA[a+1]);
+                movesB[batch.size()] = Move(nodesB[b], nodesB[b+1]);
+                batch.add(movesA[batch.size()], movesB[batch.size()]);
+            }
         }
         else if(a == nodesA.size() - 1) // if agent A has already reached the goal
         {
             if(sqrt(pow(nodesA[a].i - nodesB[b].i, 2) + pow(nodesA[a].j - nodesB[b].j, 2)) - CN_EPSILON < (nodesB[b+1].g - nodesB[b].g))
-                if(check_conflict(Move(nodesA[a].g, CN_INFINITY, nodesA[a].i, nodesA[a].j, nodesA[a].i, nodesA[a].j, nodesA[a].id, nodesA[a].id), Move(nodesB[b], nodesB[b+1])))
-                    return Conflict(pathA.agentID, pathB.agentID, Move(nodesA[a].g, CN_INFINITY, nodesA[a].i, nodesA[a].j, nodesA[a].i, nodesA[a].j, nodesA[a].id, nodesA[a].id), Move(nodesB[b], nodesB[b+1]), std::min(nodesA[a].g, nodesB[b].g));
+            {
+                movesA[batch.size()] = Move(nodesA[a].g, CN_INFINITY, nodesA[a].i, nodesA[a].j, nodesA[a].i, nodesA[a].j, nodesA[a].id, nodesA[a].id);
+                movesB[batch.size()] = Move(nodesB[b], nodesB[b+1]);
+                batch.add(movesA[batch.size()], movesB[batch.size()]);
+            }
         }
         else if(b == nodesB.size() - 1) // if agent B has already reached the goal
         {
             if(sqrt(pow(nodesA[a].i - nodesB[b].i, 2) + pow(nodesA[a].j - nodesB[b].j, 2)) - CN_EPSILON < (nodesA[a+1].g - nodesA[a].g))
-                if(check_conflict(Move(nodesA[a], nodesA[a+1]), Move(nodesB[b].g, CN_INFINITY, nodesB[b].i, nodesB[b].j, nodesB[b].i, nodesB[b].j, nodesB[b].id, nodesB[b].id)))
-                    return Conflict(pathA.agentID, pathB.agentID, Move(nodesA[a], nodesA[a+1]), Move(nodesB[b].g, CN_INFINITY, nodesB[b].i, nodesB[b].j, nodesB[b].i, nodesB[b].j, nodesB[b].id, nodesB[b].id), std::min(nodesA[a].g, nodesB[b].g));
+            {
+                movesA[batch.size()] = Move(nodesA[a], nodesA[a+1]);
+                movesB[batch.size()] = Move(nodesB[b].g, CN_INFINITY, nodesB[b].i, nodesB[b].j, nodesB[b].i, nodesB[b].j, nodesB[b].id, nodesB[b].id);
+                batch.add(movesA[batch.size()], movesB[batch.size()]);
+            }
+        }
+        if(batch.full())
+        {
+            Conflict conflict = get_first_conflict(pathA.agentID, pathB.agentID, batch, movesA, movesB);
+            if(conflict.agent1 >= 0)
+                return conflict;
+            batch.clear();
         }
         if(a == nodesA.size() - 1)
             b++;
@@ -668,28 +915,39 @@ Conflict CBS::check_paths(Path pathA, Path pathB)
         else if(nodesB[b+1].g - CN_EPSILON < nodesA[a+1].g)
             b++;
     }
+    return get_first_conflict(pathA.agentID, pathB.agentID, batch, movesA, movesB);
+}
+
+Conflict CBS::get_first_conflict(int agent1, int agent2, const Move_Batch &batch, const Move *movesA, const Move *movesB)
+{
+    unsigned int mask = batch.size() > 0 ? batch.check() : 0;
+    for(int k = 0; k < batch.size(); k++)
+        if((mask >> k) & 1)
+            return Conflict(agent1, agent2, movesA[k], movesB[k], std::min(movesA[k].t1, movesB[k].t1));
     return Conflict();
 }
 
-std::vector<Conflict> CBS::get_all_conflicts(std::vector<Path> &paths, int id)
+std::vector<Conflict> CBS::get_all_conflicts(const Persistent_Array<std::shared_ptr<const Path>> &paths, int id, Conflict_Index &index)
 {
     std::vector<Conflict> conflicts;
+    //only the pairs of agents that share a cell of the index at overlapping times are checked
+    index.update(paths);
     //check all agents
     if(id < 0)
         for(unsigned int i = 0; i < paths.size(); i++)
-            for(unsigned int j = i + 1; j < paths.size(); j++)
+            for(auto j: index.get_candidates(i))
             {
-                Conflict conflict = check_paths(paths[i], paths[j]);
+                if(j <= int(i))
+                    continue;
+                Conflict conflict = check_paths(*paths[i], *paths[j]);
                 if(conflict.agent1 >= 0)
                     conflicts.push_back(conflict);
             }
     else
     {
-        for(unsigned int i = 0; i < paths.size(); i++)
+        for(auto i: index.get_candidates(id))
         {
-            if(int(i) == id)
-                continue;
-            Conflict conflict = check_paths(paths[i], paths[id]);
+            Conflict conflict = check_paths(*paths[i], *paths[id]);
             if(conflict.agent1 >= 0)
                 conflicts.push_back(conflict);
         }
@@ -697,29 +955,15 @@ std::vector<Conflict> CBS::get_all_conflicts(std::vector<Path> &paths, int id)
     return conflicts;
 }
 
-double CBS::get_cost(CBS_Node node, int agent_id)
+double CBS::get_cost(const CBS_Node &node, int agent_id)
 {
-    while(node.parent != nullptr)
-    {
-        if(node.paths.begin()->agentID == agent_id)
-            return node.paths.begin()->cost;
-        node = *node.parent;
-    }
-    return node.paths.at(agent_id).cost;
+    return node.paths[agent_id]->cost;
 }
 
 std::vector<Path> CBS::get_paths(CBS_Node *node, unsigned int agents_size)
 {
-    CBS_Node* curNode = node;
     std::vector<Path> paths(agents_size);
-    while(curNode->parent != nullptr)
-    {
-        if(paths.at(curNode->paths.begin()->agentID).cost < 0)
-            paths.at(curNode->paths.begin()->agentID) = *curNode->paths.begin();
-        curNode = curNode->parent;
-    }
     for(unsigned int i = 0; i < agents_size; i++)
-        if(paths.at(i).cost < 0)
-            paths.at(i) = curNode->paths.at(i);
+        paths[i] = *node->paths[i];
     return paths;
 }
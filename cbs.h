@@ -7,37 +7,60 @@
 #include "config.h"
 #include "sipp.h"
 #include "heuristic.h"
+#include "path_cache.h"
+#include "thread_pool.h"
+#include "conflict_index.h"
+#include "move_batch.h"
 #include "simplex/simplex.h"
 #include "simplex/pilal.h"
 
 class CBS
 {
 public:
-    CBS() {}
-    Solution find_solution(const Map &map, const Task &task, const Config &cfg);
+    CBS():h_values(nullptr), cancelled(nullptr) {}
+    Solution find_solution(const Map &map, const Task &task, const Config &cfg, const Heuristic *shared_heuristic = nullptr, const std::atomic<bool> *cancel = nullptr);
 private:
     bool init_root(const Map &map, const Task &task);
+    Path find_path(Agent agent, const Map &map, std::list<Constraint> cons, SIPP &sipp, double max_cost = CN_INFINITY);
+    double get_probe_bound(const CBS_Node &node, int agent);
     std::list<Constraint> get_constraints(CBS_Node *node, int agent_id = -1);
     //std::list<Constraint> merge_constraints(std::list<Constraint> constraints);
     bool validate_constraints(std::list<Constraint> constraints, int agent);
     bool check_positive_constraints(std::list<Constraint> constraints, Constraint constraint);
     Conflict check_conflicts(std::vector<Path> &paths, std::vector<int> conflicting_agents, std::vector<std::pair<int, int> > conflicting_pairs);
-    Conflict check_paths(Path pathA, Path pathB);
+    Conflict check_paths(const Path &pathA, const Path &pathB);
     bool check_conflict(Move move1, Move move2);
-    double get_hl_heuristic(const std::list<Conflict> &conflicts);
-    std::vector<Conflict> get_all_conflicts(std::vector<Path> &paths, int id);
+    Conflict get_first_conflict(int agent1, int agent2, const Move_Batch &batch, const Move *movesA, const Move *movesB);
+    double get_hl_heuristic(const Conflict_List &conflicts);
+    std::vector<Conflict> get_all_conflicts(const Persistent_Array<std::shared_ptr<const Path>> &paths, int id, Conflict_Index &index);
     Constraint get_constraint(int agent, Move move1, Move move2);
     Constraint get_wait_constraint(int agent, Move move1, Move move2);
-    void find_new_conflicts(const Map &map, const Task &task, CBS_Node &node, std::vector<Path> paths, Path path,
-                            std::list<Conflict> conflicts, std::list<Conflict> semicard_conflicts, std::list<Conflict> cardinal_conflicts,
-                            int &low_level_searches, int &low_level_expanded);
-    double get_cost(CBS_Node node, int agent_id);
+    double get_unsafe_end(const Move &move1, const Move &move2);
+    double get_unsafe_end_bisection(Move move1, const Move &move2);
+    void update_unsafe_end(Vector2D p, Vector2D q, double lo, double hi, double &end);
+    void get_queries(CBS_Node &node, const Path &path, const std::vector<Conflict> &new_conflicts,
+                     std::vector<int> &agents, std::vector<std::list<Constraint>> &constraints, std::vector<double> &bounds);
+    void find_new_conflicts(CBS_Node &node, const Path &path, const Conflict_List &conflicts, const Conflict_List &semicard_conflicts, const Conflict_List &cardinal_conflicts, const Conflict_List &unclassified_conflicts,
+                            const std::vector<Conflict> &new_conflicts, const std::vector<Path> &new_paths, unsigned int offset, HL_Stats &stats);
+    bool classify_conflict(CBS_Node &node, Conflict conflict, const Path &path1, const Path &path2, HL_Stats &stats);
+    bool classify_conflicts(CBS_Node &node, const Map &map, const Task &task, HL_Stats &stats, int thread);
+    bool expand(CBS_Node &node, CBS_Node *parent, const Map &map, const Task &task, std::vector<CBS_Node> &children, HL_Stats &stats, int thread = -1);
+    bool parallel_search(const Map &map, const Task &task, CBS_Node &node, HL_Stats &stats, std::chrono::high_resolution_clock::time_point start);
+    void run_tasks(int tasks, std::function<void(int, int)> task, int thread);
+    bool is_cancelled() const { return cancelled != nullptr && cancelled->load(); }
+    double get_cost(const CBS_Node &node, int agent_id);
     std::vector<Path> get_paths(CBS_Node *node, unsigned int agents_size);
-    Conflict get_conflict(std::list<Conflict> &conflicts);
+    void add_conflict(Conflict_List &conflicts, const Conflict &conflict);
     CBS_Tree tree;
-    SIPP planner;
+    std::vector<SIPP> planners;//one planner per thread of the pool, the first one is used by the main thread
+    Thread_Pool pool;
+    std::vector<Conflict_Index> indexes;//one broad-phase index per thread of the pool, each follows the paths of the nodes its thread checks
+    std::atomic<int> next_id;
     Solution solution;
-    Heuristic h_values;
+    Heuristic heuristic;//is counted by the solver itself when no shared one is given
+    const Heuristic *h_values;
+    const std::atomic<bool> *cancelled;//is set when another solver of the portfolio has already found a solution
+    Path_Cache cache;
     Config config;
 
 };
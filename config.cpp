@@ -4,6 +4,18 @@ Config::Config()
 {
     connectdness = CN_CONNECTEDNESS;
     use_cardinal = CN_USE_CARDINAL;
+    use_incremental = CN_USE_INCREMENTAL;
+    lazy_classification = CN_LAZY_CLASSIFICATION;
+    bounded_probes = CN_BOUNDED_PROBES;
+    cache_size = CN_CACHE_SIZE;
+    threads = CN_THREADS;
+    parallel_hl = CN_PARALLEL_HL;
+    hlh_type = CN_HLH_TYPE;
+    interval_mode = CN_INTERVAL_MODE;
+    h_storage = CN_H_STORAGE;
+    pivots = CN_PIVOTS;
+    lazy_heuristic = CN_LAZY_HEURISTIC;
+    use_ds = CN_USE_DS;
     agent_size = CN_AGENT_SIZE;
     timelimit = CN_TIMELIMIT;
     focal_weight = CN_FOCAL_WEIGHT;
@@ -79,6 +91,246 @@ void Config::getConfig(const char *fileName)
         }
     }
 
+    element = algorithm->FirstChildElement("lazy_classification");
+    if (!element)
+    {
+        std::cout << "Error! No 'lazy_classification' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_LAZY_CLASSIFICATION<<"'."<<std::endl;
+        lazy_classification = CN_LAZY_CLASSIFICATION;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            lazy_classification = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            lazy_classification = false;
+        else
+        {
+            std::cout << "Error! Wrong 'lazy_classification' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_LAZY_CLASSIFICATION<<"'."<<std::endl;
+            lazy_classification = CN_LAZY_CLASSIFICATION;
+        }
+    }
+
+    element = algorithm->FirstChildElement("bounded_probes");
+    if (!element)
+    {
+        std::cout << "Error! No 'bounded_probes' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_BOUNDED_PROBES<<"'."<<std::endl;
+        bounded_probes = CN_BOUNDED_PROBES;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            bounded_probes = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            bounded_probes = false;
+        else
+        {
+            std::cout << "Error! Wrong 'bounded_probes' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_BOUNDED_PROBES<<"'."<<std::endl;
+            bounded_probes = CN_BOUNDED_PROBES;
+        }
+    }
+
+    element = algorithm->FirstChildElement("use_incremental");
+    if (!element)
+    {
+        std::cout << "Error! No 'use_incremental' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_USE_INCREMENTAL<<"'."<<std::endl;
+        use_incremental = CN_USE_INCREMENTAL;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            use_incremental = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            use_incremental = false;
+        else
+        {
+            std::cout << "Error! Wrong 'use_incremental' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_USE_INCREMENTAL<<"'."<<std::endl;
+            use_incremental = CN_USE_INCREMENTAL;
+        }
+    }
+
+    element = algorithm->FirstChildElement("cache_size");
+    if (!element)
+    {
+        std::cout << "Error! No 'cache_size' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_CACHE_SIZE<<"'."<<std::endl;
+        cache_size = CN_CACHE_SIZE;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>cache_size;
+        if(cache_size < 0)
+        {
+            std::cout << "Error! Wrong 'cache_size' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_CACHE_SIZE<<"'."<<std::endl;
+            cache_size = CN_CACHE_SIZE;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("threads");
+    if (!element)
+    {
+        std::cout << "Error! No 'threads' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_THREADS<<"'."<<std::endl;
+        threads = CN_THREADS;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>threads;
+        if(threads < 1)
+        {
+            std::cout << "Error! Wrong 'threads' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_THREADS<<"'."<<std::endl;
+            threads = CN_THREADS;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("parallel_hl");
+    if (!element)
+    {
+        std::cout << "Error! No 'parallel_hl' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_PARALLEL_HL<<"'."<<std::endl;
+        parallel_hl = CN_PARALLEL_HL;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            parallel_hl = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            parallel_hl = false;
+        else
+        {
+            std::cout << "Error! Wrong 'parallel_hl' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_PARALLEL_HL<<"'."<<std::endl;
+            parallel_hl = CN_PARALLEL_HL;
+        }
+    }
+
+    element = algorithm->FirstChildElement("hlh_type");
+    if (!element)
+    {
+        std::cout << "Error! No 'hlh_type' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_HLH_TYPE<<"'."<<std::endl;
+        hlh_type = CN_HLH_TYPE;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>hlh_type;
+        if(hlh_type < 0 || hlh_type > 2)
+        {
+            std::cout << "Error! Wrong 'hlh_type' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_HLH_TYPE<<"'."<<std::endl;
+            hlh_type = CN_HLH_TYPE;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("use_ds");
+    if (!element)
+    {
+        std::cout << "Error! No 'use_ds' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_USE_DS<<"'."<<std::endl;
+        use_ds = CN_USE_DS;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            use_ds = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            use_ds = false;
+        else
+        {
+            std::cout << "Error! Wrong 'use_ds' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_USE_DS<<"'."<<std::endl;
+            use_ds = CN_USE_DS;
+        }
+    }
+
+    element = algorithm->FirstChildElement("interval_mode");
+    if (!element)
+    {
+        std::cout << "Error! No 'interval_mode' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_INTERVAL_MODE<<"'."<<std::endl;
+        interval_mode = CN_INTERVAL_MODE;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>interval_mode;
+        if(interval_mode < 0 || interval_mode > 2)
+        {
+            std::cout << "Error! Wrong 'interval_mode' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_INTERVAL_MODE<<"'."<<std::endl;
+            interval_mode = CN_INTERVAL_MODE;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("h_storage");
+    if (!element)
+    {
+        std::cout << "Error! No 'h_storage' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_H_STORAGE<<"'."<<std::endl;
+        h_storage = CN_H_STORAGE;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>h_storage;
+        if(h_storage < 0 || h_storage > 2)
+        {
+            std::cout << "Error! Wrong 'h_storage' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_H_STORAGE<<"'."<<std::endl;
+            h_storage = CN_H_STORAGE;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("pivots");
+    if (!element)
+    {
+        std::cout << "Error! No 'pivots' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_PIVOTS<<"'."<<std::endl;
+        pivots = CN_PIVOTS;
+    }
+    else
+    {
+        auto value = element->GetText();
+        stream<<value;
+        stream>>pivots;
+        if(pivots < 0)
+        {
+            std::cout << "Error! Wrong 'pivots' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_PIVOTS<<"'."<<std::endl;
+            pivots = CN_PIVOTS;
+        }
+        stream.clear();
+        stream.str("");
+    }
+
+    element = algorithm->FirstChildElement("lazy_heuristic");
+    if (!element)
+    {
+        std::cout << "Error! No 'lazy_heuristic' element found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_LAZY_HEURISTIC<<"'."<<std::endl;
+        lazy_heuristic = CN_LAZY_HEURISTIC;
+    }
+    else
+    {
+        std::string value = element->GetText();
+        if(value.compare("true") == 0 || value.compare("1") == 0)
+            lazy_heuristic = true;
+        else if(value.compare("false") == 0 || value.compare("0") == 0)
+            lazy_heuristic = false;
+        else
+        {
+            std::cout << "Error! Wrong 'lazy_heuristic' value found inside '"<<CNS_TAG_ALGORITHM<<"' section. It's compared to '"<<CN_LAZY_HEURISTIC<<"'."<<std::endl;
+            lazy_heuristic = CN_LAZY_HEURISTIC;
+        }
+    }
+
     element = algorithm->FirstChildElement("connectedness");
     if (!element)
     {
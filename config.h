@@ -15,6 +15,18 @@ public:
     double  precision;
     double  focal_weight;
     bool    use_cardinal;
+    bool    lazy_classification;
+    bool    bounded_probes;
+    bool    use_incremental;
+    int     cache_size;
+    int     threads;
+    bool    parallel_hl;
+    int     hlh_type;
+    int     interval_mode;
+    int     h_storage;
+    int     pivots;
+    bool    lazy_heuristic;
+    bool    use_ds;
     int     connectdness;
     double  agent_size;
     double  timelimit;
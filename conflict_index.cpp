@@ -0,0 +1,100 @@
+#include "conflict_index.h"
+
+void Conflict_Index::init(double agent_size, unsigned int agents)
+{
+    radius = agent_size + CN_EPSILON;
+    cell_size = 0;
+    cells.clear();
+    agent_cells.assign(agents, {});
+    indexed.assign(agents, nullptr);
+    marked.assign(agents, 0);
+}
+
+void Conflict_Index::add_box(int agent, double i1, double j1, double i2, double j2, double t1, double t2)
+{
+    int x1 = int(floor((std::min(i1, i2) - radius)/cell_size)), x2 = int(floor((std::max(i1, i2) + radius)/cell_size));
+    int y1 = int(floor((std::min(j1, j2) - radius)/cell_size)), y2 = int(floor((std::max(j1, j2) + radius)/cell_size));
+    for(int x = x1; x <= x2; x++)
+        for(int y = y1; y <= y2; y++)
+        {
+            long long key = get_key(x, y);
+            std::vector<Entry> &entries = cells[key];
+            //the moves of an agent are added in order, so its consecutive visits of the cell are merged
+            if(!entries.empty() && entries.back().agent == agent && t1 < entries.back().t2 + CN_EPSILON)
+                entries.back().t2 = std::max(entries.back().t2, t2);
+            else
+            {
+                entries.emplace_back(agent, t1, t2);
+                agent_cells[agent].push_back(key);
+            }
+        }
+}
+
+void Conflict_Index::add_path(int agent, const Path &path)
+{
+    for(unsigned int k = 0; k + 1 < path.nodes.size(); k++)
+        add_box(agent, path.nodes[k].i, path.nodes[k].j, path.nodes[k+1].i, path.nodes[k+1].j, path.nodes[k].g, path.nodes[k+1].g);
+    if(!path.nodes.empty()) //the agent stays at its goal forever
+        add_box(agent, path.nodes.back().i, path.nodes.back().j, path.nodes.back().i, path.nodes.back().j, path.nodes.back().g, CN_INFINITY);
+}
+
+void Conflict_Index::remove_path(int agent)
+{
+    std::vector<long long> &keys = agent_cells[agent];
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for(auto key: keys)
+    {
+        std::vector<Entry> &entries = cells[key];
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [agent](const Entry &e){ return e.agent == agent; }), entries.end());
+    }
+    keys.clear();
+}
+
+void Conflict_Index::update(const Persistent_Array<std::shared_ptr<const Path>> &paths)
+{
+    if(cell_size <= 0) //the cells are about as large as an average move, so that each move covers just a few of them
+    {
+        double length(0);
+        int moves(0);
+        for(unsigned int a = 0; a < paths.size(); a++)
+            for(unsigned int k = 0; k + 1 < paths[a]->nodes.size(); k++)
+            {
+                length += sqrt(pow(paths[a]->nodes[k].i - paths[a]->nodes[k+1].i, 2) + pow(paths[a]->nodes[k].j - paths[a]->nodes[k+1].j, 2));
+                moves++;
+            }
+        cell_size = std::max(length/std::max(moves, 1), 2*radius);
+    }
+    for(unsigned int a = 0; a < paths.size(); a++)
+        if(indexed[a] != paths[a])
+        {
+            if(indexed[a] != nullptr)
+                remove_path(a);
+            add_path(a, *paths[a]);
+            indexed[a] = paths[a];
+        }
+}
+
+std::vector<int> Conflict_Index::get_candidates(int agent)
+{
+    std::vector<int> candidates;
+    std::vector<long long> &keys = agent_cells[agent];
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for(auto key: keys)
+    {
+        const std::vector<Entry> &entries = cells[key];
+        for(auto& own: entries)
+            if(own.agent == agent)
+                for(auto& other: entries)
+                    if(other.agent != agent && !marked[other.agent] && other.t1 < own.t2 + CN_EPSILON && own.t1 < other.t2 + CN_EPSILON)
+                    {
+                        marked[other.agent] = 1;
+                        candidates.push_back(other.agent);
+                    }
+    }
+    for(auto c: candidates)
+        marked[c] = 0;
+    std::sort(candidates.begin(), candidates.end());
+    return candidates;
+}
@@ -0,0 +1,33 @@
+#ifndef CONFLICT_INDEX_H
+#define CONFLICT_INDEX_H
+#include "structs.h"
+#include "const.h"
+#include <unordered_map>
+
+class Conflict_Index //uniform grid over the swept bounding boxes of the agents' moves; only the agents sharing a cell at overlapping times may collide
+{
+public:
+    Conflict_Index():radius(0), cell_size(0) {}
+    void init(double agent_size, unsigned int agents);
+    void update(const Persistent_Array<std::shared_ptr<const Path>> &paths);//re-indexes only the paths that differ from the indexed ones
+    std::vector<int> get_candidates(int agent);//sorted agents that may collide with the given one
+private:
+    struct Entry
+    {
+        int agent;
+        double t1, t2;
+        Entry(int _agent, double _t1, double _t2):agent(_agent), t1(_t1), t2(_t2) {}
+    };
+    long long get_key(int x, int y) const { return static_cast<long long>((static_cast<unsigned long long>(static_cast<unsigned int>(x)) << 32) | static_cast<unsigned int>(y)); }
+    void add_box(int agent, double i1, double j1, double i2, double j2, double t1, double t2);
+    void add_path(int agent, const Path &path);
+    void remove_path(int agent);
+    std::unordered_map<long long, std::vector<Entry>> cells;
+    std::vector<std::vector<long long>> agent_cells;
+    std::vector<std::shared_ptr<const Path>> indexed;
+    std::vector<char> marked;
+    double radius;
+    double cell_size;
+};
+
+#endif // CONFLICT_INDEX_H
@@ -4,6 +4,17 @@
 #define CN_USE_CARDINAL  1
 #define CN_HLH_TYPE      0
 #define CN_USE_DS        0
+#define CN_USE_INCREMENTAL 0
+#define CN_BOUNDED_PROBES 0 // whether the searches that classify conflicts stop as soon as the path can't be as cheap as the current one
+#define CN_LAZY_CLASSIFICATION 0 // whether the conflicts are classified only when a conflict of the node is selected
+#define CN_THREADS       1 // number of threads that look for the paths of the new conflicts
+#define CN_PARALLEL_HL   0 // whether the threads expand different high-level nodes at the same time
+#define CN_INTERVAL_MODE 1 // 0 - the ends of unsafe intervals are found by bisection, 1 - in closed form, 2 - in closed form verified by bisection
+#define CN_H_STORAGE     0 // 0 - the heuristic tables keep doubles, 1 - floats, 2 - 16-bit fixed-point values; 1 and 2 are bounded-suboptimal by the rounding step
+#define CN_LAZY_HEURISTIC 0 // whether the heuristic tables are counted on demand by Reverse Resumable A*
+#define CN_PIVOTS        16 // max number of goals used as the pivots of the differential heuristic, 0 - all of them
+#define CN_CACHE_SIZE    10000 // max number of paths kept in the cache of low-level searches, 0 disables it
+#define CN_SIPP_RECORDS  4 // number of low-level searches that are kept per agent to be repaired in the incremental mode
 #define CN_TIMELIMIT     30 // in seconds
 #define CN_AGENT_SIZE    sqrt(2.0)/4.0 //radius; only values in range (0; 0.5] are supported
 #define CN_CONNECTEDNESS 2
@@ -65,5 +76,6 @@
     #define CNS_TAG_ATTR_FY             "finish.y"
     #define CNS_TAG_ATTR_FLOWTIME       "flowtime"
     #define CNS_TAG_ATTR_MAKESPAN       "makespan"
+    #define CNS_TAG_ATTR_CONFIG         "config"
 
 #endif // CONST_H
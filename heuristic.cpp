@@ -1,22 +1,214 @@
 #include "heuristic.h"
+#include <cstring>
+#include <cfloat>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-void Heuristic::init(unsigned int size, unsigned int agents)
+unsigned long long Radix_Heap::to_bits(double key)
 {
-    h_values.clear();
-    h_values.resize(size);
-    for(unsigned int i = 0; i < size; i++)
-        h_values[i].resize(agents, -1);
+    unsigned long long bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return bits;
 }
 
-void Heuristic::count(const Map &map, Agent agent)
+double Radix_Heap::to_key(unsigned long long bits)
 {
+    double key;
+    std::memcpy(&key, &bits, sizeof(key));
+    return key;
+}
+
+void Radix_Heap::push(double key, int value)
+{
+    unsigned long long bits = to_bits(key);
+    buckets[get_bucket(bits)].push_back({bits, value});
+    size++;
+}
+
+std::pair<double, int> Radix_Heap::pop()
+{
+    if(buckets[0].empty())
+    {
+        //the least key of the first non-empty bucket becomes the last one, and its elements are spread over the lower buckets
+        int k = 1;
+        while(buckets[k].empty())
+            k++;
+        last = buckets[k][0].first;
+        for(auto& e: buckets[k])
+            last = std::min(last, e.first);
+        for(auto& e: buckets[k])
+            buckets[get_bucket(e.first)].push_back(e);
+        buckets[k].clear();
+    }
+    auto e = buckets[0].back();
+    buckets[0].pop_back();
+    size--;
+    return {to_key(e.first), e.second};
+}
+
+Lazy_Table::Page::Page()
+{
+    for(int k = 0; k < page_size; k++)
+    {
+        g[k] = CN_INFINITY;
+        closed[k] = false;
+    }
+}
+
+Lazy_Table::Lazy_Table(const Map &map, const Agent &agent):map(&map), target_i(agent.start_i), target_j(agent.start_j)
+{
+    int pages_num = (map.get_size() + page_size - 1)/page_size;
+    pages.reset(new std::atomic<Page*>[pages_num]);
+    for(int k = 0; k < pages_num; k++)
+        pages[k] = nullptr;
+    get_page(agent.goal_id)->g[agent.goal_id%page_size] = 0;
+    open.push({std::sqrt(pow(agent.goal_i - target_i, 2) + pow(agent.goal_j - target_j, 2)), agent.goal_id});
+}
+
+Lazy_Table::Page* Lazy_Table::get_page(int id)
+{
+    Page *page = pages[id/page_size].load(std::memory_order_relaxed);
+    if(page == nullptr)
+    {
+        owned_pages.emplace_back(new Page());
+        page = owned_pages.back().get();
+        pages[id/page_size].store(page, std::memory_order_release);
+    }
+    return page;
+}
+
+void Lazy_Table::resume(int id)
+{
+    //the heuristic of the search is the distance to the target, it's consistent, so the g-values of the closed nodes are the true distances
+    while(!open.empty())
+    {
+        Page *page = pages[id/page_size].load(std::memory_order_relaxed);
+        if(page != nullptr && page->closed[id%page_size].load(std::memory_order_relaxed))
+            return;
+        int cur = open.top().second;
+        open.pop();
+        Page *cur_page = get_page(cur);
+        if(cur_page->closed[cur%page_size].load(std::memory_order_relaxed))
+            continue;//the node was pushed several times and is already expanded
+        double g = cur_page->g[cur%page_size];
+        cur_page->closed[cur%page_size].store(true, std::memory_order_release);
+        double i = map->get_i(cur), j = map->get_j(cur);
+        for(auto& move: map->get_valid_moves(cur))
+        {
+            Page *next_page = get_page(move.id);
+            double new_g = g + std::sqrt(pow(i - move.i, 2) + pow(j - move.j, 2));
+            if(!next_page->closed[move.id%page_size].load(std::memory_order_relaxed) && next_page->g[move.id%page_size] > new_g)
+            {
+                next_page->g[move.id%page_size] = new_g;
+                open.push({new_g + std::sqrt(pow(move.i - target_i, 2) + pow(move.j - target_j, 2)), move.id});
+            }
+        }
+    }
+}
+
+double Lazy_Table::get_value(int id)
+{
+    Page *page = pages[id/page_size].load(std::memory_order_acquire);
+    if(page != nullptr && page->closed[id%page_size].load(std::memory_order_acquire))
+        return page->g[id%page_size];
+    std::lock_guard<std::mutex> lock(mutex);
+    resume(id);
+    page = pages[id/page_size].load(std::memory_order_relaxed);
+    if(page != nullptr && page->closed[id%page_size].load(std::memory_order_relaxed))
+        return page->g[id%page_size];
+    return -1;//the node is unreachable
+}
+
+void Heuristic::init(unsigned int size, int storage, int pivots, bool lazy)
+{
+    this->size = size;
+    this->storage = storage;
+    this->lazy = lazy;
+    pivots_num = pivots;
+    tables.clear();
+    lazy_tables.clear();
+}
+
+void Heuristic::allocate(unsigned int tables_num)
+{
+    values.clear();
+    float_values.clear();
+    fixed_values.clear();
+    if(storage == 0)
+        values.assign(std::size_t(size)*tables_num, -1);
+    else if(storage == 1)
+        float_values.assign(std::size_t(size)*tables_num, -1);
+    else
+        fixed_values.assign(std::size_t(size)*tables_num, 65535);
+    values.shrink_to_fit();
+    float_values.shrink_to_fit();
+    fixed_values.shrink_to_fit();
+    steps.assign(tables_num, 1);
+    errors.assign(tables_num, 0);
+}
+
+void Heuristic::set_values(int table, const std::vector<double> &g)
+{
+    std::size_t offset = std::size_t(table)*size;
+    double max_value(0);
+    for(auto v: g)
+        if(v < CN_INFINITY)
+            max_value = std::max(max_value, v);
+    if(storage == 0)
+    {
+        for(std::size_t v = 0; v < size; v++)
+            values[offset + v] = (g[v] < CN_INFINITY ? g[v] : -1);
+    }
+    else if(storage == 1)
+    {
+        for(std::size_t v = 0; v < size; v++)
+        {
+            float value = (g[v] < CN_INFINITY ? float(g[v]) : -1);
+            if(g[v] < CN_INFINITY && value > g[v])
+                value = std::nextafter(value, 0.0f);
+            float_values[offset + v] = value;
+        }
+        errors[table] = max_value*2*FLT_EPSILON;
+    }
+    else
+    {
+        //each table has its own step, so the whole range of the values is covered by 65535 units
+        steps[table] = std::max(max_value, 1.0)/65534;
+        for(std::size_t v = 0; v < size; v++)
+        {
+            if(g[v] >= CN_INFINITY)
+                continue;
+            double units = std::floor(g[v]/steps[table]);
+            if(units*steps[table] > g[v])
+                units--;
+            fixed_values[offset + v] = (unsigned short)(std::min(std::max(units, 0.0), 65534.0));
+        }
+        errors[table] = steps[table];
+    }
+}
+
+void Heuristic::count(const Map &map, Agent agent, int table)
+{
+    //each call has its own open list and writes only the values of its table
+    std::vector<double> g(map.get_size(), CN_INFINITY);
+    std::vector<char> closed(map.get_size(), false);
+    std::vector<std::pair<double, double>> coords(map.get_size());//the queue keeps only the ids of the nodes
+    Radix_Heap open;
     Node curNode(agent.goal_id, 0, 0, agent.goal_i, agent.goal_j), newNode;
-    open.clear();
-    open.insert(curNode);
+    g[curNode.id] = 0;
+    coords[curNode.id] = {curNode.i, curNode.j};
+    open.push(0, curNode.id);
     while(!open.empty())
     {
-        curNode = find_min();
-        h_values[curNode.id][agent.id] = curNode.g;
+        auto min = open.pop();
+        if(closed[min.second] || min.first > g[min.second])
+            continue;//the node is already expanded or there is a better entry in the queue
+        curNode.id = min.second;
+        curNode.g = min.first;
+        curNode.i = coords[curNode.id].first;
+        curNode.j = coords[curNode.id].second;
+        closed[curNode.id] = true;
         std::vector<Node> valid_moves = map.get_valid_moves(curNode.id);
         for(auto move: valid_moves)
         {
@@ -24,27 +216,122 @@ void Heuristic::count(const Map &map, Agent agent)
             newNode.j = move.j;
             newNode.id = move.id;
             newNode.g = curNode.g + dist(curNode, newNode);
-            if(h_values[newNode.id][agent.id] < 0)
+            if(!closed[newNode.id] && g[newNode.id] > newNode.g)
             {
-                auto it = open.get<1>().find(newNode.id);
-                if(it != open.get<1>().end())
-                {
-                    if(it->g > newNode.g)
-                        open.get<1>().erase(it);
-                    else
-                        continue;
-                }
-                open.insert(newNode);
+                g[newNode.id] = newNode.g;
+                coords[newNode.id] = {newNode.i, newNode.j};
+                open.push(newNode.g, newNode.id);
             }
         }
     }
+    set_values(table, g);
+}
 
+void Heuristic::count(const Map &map, const Task &task, Thread_Pool &pool)
+{
+    //the agents with the same goal share the table, it's counted from the goal of the first of them
+    std::unordered_map<int, int> goal_tables;
+    std::vector<int> owners;
+    tables.resize(task.get_agents_size());
+    for(unsigned int i = 0; i < task.get_agents_size(); i++)
+    {
+        auto it = goal_tables.emplace(task.get_agent(i).goal_id, int(owners.size())).first;
+        if(it->second == int(owners.size()))
+            owners.push_back(i);
+        tables[i] = it->second;
+    }
+    goals.clear();
+    for(auto owner: owners)
+        goals.push_back(task.get_agent(owner).goal_id);
+    if(lazy)
+    {
+        //nothing is counted in advance, each table is searched towards the start of the first agent with its goal
+        for(auto owner: owners)
+            lazy_tables.emplace_back(new Lazy_Table(map, task.get_agent(owner)));
+        errors.assign(owners.size(), 0);
+        select_pivots(task, owners);
+        return;
+    }
+    allocate(owners.size());
+    pool.run(int(owners.size()), [&](int k, int)
+    {
+        count(map, task.get_agent(owners[k]), k);
+    });
+    select_pivots(task, owners);
 }
 
-Node Heuristic::find_min()
+void Heuristic::select_pivots(const Task &task, const std::vector<int> &owners)
 {
-    Node min = *open.begin();
-    open.erase(open.begin());
-    return min;
+    //farthest-point selection: each next pivot is the goal that is the farthest from the already selected ones;
+    //the lazy tables aren't searched for it, so the straight-line distances between the goals are used instead
+    int tables_num = int(errors.size());
+    int k = (pivots_num > 0 ? std::min(pivots_num, tables_num) : tables_num);
+    pivots.clear();
+    std::vector<double> min_dist(tables_num, CN_INFINITY);
+    int next = 0;
+    while(int(pivots.size()) < k)
+    {
+        pivots.push_back(next);
+        Agent pivot = task.get_agent(owners[next]);
+        int farthest = -1;
+        for(int t = 0; t < tables_num; t++)
+        {
+            Agent agent = task.get_agent(owners[t]);
+            double d = lazy ? std::sqrt(pow(agent.goal_i - pivot.goal_i, 2) + pow(agent.goal_j - pivot.goal_j, 2)) : get_table_value(goals[t], next);
+            min_dist[t] = std::min(min_dist[t], d);
+            if(farthest < 0 || min_dist[t] > min_dist[farthest])
+                farthest = t;
+        }
+        next = farthest;
+    }
+    if(lazy)
+        return;//the values of the pivots are asked from their lazy tables
+    pivots_stride = (k + 3)/4*4;
+    pivot_values.assign(size*pivots_stride, 0);
+    pivot_errors.assign(pivots_stride, 0);
+    for(int p = 0; p < k; p++)
+    {
+        pivot_errors[p] = errors[pivots[p]];
+        for(std::size_t v = 0; v < size; v++)
+            pivot_values[v*pivots_stride + p] = get_table_value(v, pivots[p]);
+    }
 }
 
+double Heuristic::get_pivots_value(int id_node, int id_goal) const
+{
+    double h(0);
+    if(lazy)
+    {
+        for(auto p: pivots)
+            h = std::max(h, std::fabs(lazy_tables[p]->get_value(id_node) - lazy_tables[p]->get_value(id_goal)));
+        return h;
+    }
+    //the estimate of each pivot is lowered by its rounding error, so it stays admissible for the compact tables
+    const double *a = &pivot_values[std::size_t(id_node)*pivots_stride], *b = &pivot_values[std::size_t(id_goal)*pivots_stride];
+    const double *e = pivot_errors.data();
+#if defined(__AVX__)
+    __m256d sign = _mm256_set1_pd(-0.0), max = _mm256_setzero_pd();
+    for(int p = 0; p < pivots_stride; p += 4)
+    {
+        __m256d d = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + p), _mm256_loadu_pd(b + p)));
+        max = _mm256_max_pd(max, _mm256_sub_pd(d, _mm256_loadu_pd(e + p)));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, max);
+    h = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(__SSE2__)
+    __m128d sign = _mm_set1_pd(-0.0), max = _mm_setzero_pd();
+    for(int p = 0; p < pivots_stride; p += 2)
+    {
+        __m128d d = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + p), _mm_loadu_pd(b + p)));
+        max = _mm_max_pd(max, _mm_sub_pd(d, _mm_loadu_pd(e + p)));
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, max);
+    h = std::max(lanes[0], lanes[1]);
+#else
+    for(int p = 0; p < pivots_stride; p++)
+        h = std::max(h, std::fabs(a[p] - b[p]) - e[p]);
+#endif
+    return h;
+}
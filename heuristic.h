@@ -6,29 +6,94 @@
 #include <vector>
 #include <unordered_map>
 #include "map.h"
+#include "task.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <functional>
 
-typedef multi_index_container<
-        Node,
-        indexed_by<
-                    //ordered_non_unique<tag<cost>, BOOST_MULTI_INDEX_MEMBER(Open_Elem, double, cost)>,
-                    ordered_non_unique<BOOST_MULTI_INDEX_MEMBER(Node, double, g)>,
-                    hashed_unique<BOOST_MULTI_INDEX_MEMBER(Node, int, id)>
-        >
-> Open_Container;
+class Radix_Heap //monotone priority queue of Dijkstra: the keys are never less than the last popped one
+{
+    std::vector<std::pair<unsigned long long, int>> buckets[65];//bucket k keeps the keys that differ from the last popped one in the k-th bit at most
+    unsigned long long last;
+    std::size_t size;
+    static unsigned long long to_bits(double key);//keeps the order of non-negative keys
+    static double to_key(unsigned long long bits);
+    int get_bucket(unsigned long long bits) const { return bits == last ? 0 : 64 - __builtin_clzll(bits ^ last); }
+public:
+    Radix_Heap():last(0), size(0) {}
+    bool empty() const { return size == 0; }
+    void push(double key, int value);
+    std::pair<double, int> pop();
+};
 
+class Lazy_Table //the reverse search from a goal towards the start of an agent, resumed whenever an unsettled node is asked (Reverse Resumable A*)
+{
+    static const int page_size = 1024;
+    struct Page //the states of the nodes are allocated by pages, only for the parts of the map reached by the search
+    {
+        double g[page_size];
+        std::atomic<char> closed[page_size];//the value of a closed node is the true distance and never changes, so it's read without locking
+        Page();
+    };
+    std::unique_ptr<std::atomic<Page*>[]> pages;
+    std::vector<std::unique_ptr<Page>> owned_pages;
+    std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> open;//f-values and ids
+    std::mutex mutex;
+    const Map *map;
+    double target_i, target_j;
+    Page* get_page(int id);
+    void resume(int id);
+public:
+    Lazy_Table(const Map &map, const Agent &agent);
+    double get_value(int id);//is thread-safe
+};
 
 class Heuristic
 {
-    std::vector<std::vector<double>> h_values;
-    Open_Container open;
-    Node find_min();
-    double dist(const Node& a, const Node& b){ return std::sqrt(pow(a.i - b.i, 2) + pow(a.j - b.j, 2)); }
+    //there is a table per goal, and the tables are stored one after another, i.e. the value of the node v in the table t is kept at t*size + v;
+    //only the vector of the chosen storage is used, the compact ones keep the values rounded down so they stay admissible
+    std::vector<double> values;
+    std::vector<float> float_values;
+    std::vector<unsigned short> fixed_values;//65535 stands for the unreachable nodes
+    std::vector<double> steps;//the cost of a unit of the fixed-point values of each table
+    std::vector<double> errors;//the largest difference between the true and the stored values of each table
+    std::vector<int> tables;//the table of each agent
+    std::vector<int> goals;//the goal of each table
+    std::vector<std::unique_ptr<Lazy_Table>> lazy_tables;//are used instead of the stored tables in the lazy mode
+    std::vector<int> pivots;//the tables used as the pivots of the differential heuristic
+    std::vector<double> pivot_values;//node-major copies of the pivot tables, i.e. the value of the pivot p for the node v is kept at v*pivots_stride + p
+    std::vector<double> pivot_errors;
+    std::size_t size;
+    int storage;
+    bool lazy;
+    int pivots_stride;//padded to the width of the vector registers with the pivots that are zero everywhere
+    int pivots_num;
+    double dist(const Node& a, const Node& b) const { return std::sqrt(pow(a.i - b.i, 2) + pow(a.j - b.j, 2)); }
+    void allocate(unsigned int tables_num);
+    void count(const Map &map, Agent agent, int table);//can be run concurrently for different tables
+    void set_values(int table, const std::vector<double> &g);
+    void select_pivots(const Task &task, const std::vector<int> &owners);
 public:
-    Heuristic(){}
-    void init(unsigned int size, unsigned int agents);
-    void count(const Map &map, Agent agent);
-    unsigned int get_size() const {return h_values[0].size();}
-    double get_value(int id_node, int id_agent) { return h_values[id_node][id_agent]; }
+    Heuristic():size(0), storage(CN_H_STORAGE), lazy(CN_LAZY_HEURISTIC), pivots_stride(0), pivots_num(CN_PIVOTS) {}
+    void init(unsigned int size, int storage = CN_H_STORAGE, int pivots = CN_PIVOTS, bool lazy = CN_LAZY_HEURISTIC);
+    void count(const Map &map, const Task &task, Thread_Pool &pool);
+    unsigned int get_size() const {return errors.size();}//the number of tables, i.e. of the distinct goals
+    double get_table_value(int id_node, int table) const
+    {
+        if(lazy)
+            return lazy_tables[table]->get_value(id_node);
+        std::size_t k = table*size + id_node;
+        if(storage == 0)
+            return values[k];
+        else if(storage == 1)
+            return float_values[k];
+        return fixed_values[k] == 65535 ? -1 : fixed_values[k]*steps[table];
+    }
+    double get_value(int id_node, int id_agent) const { return get_table_value(id_node, tables[id_agent]); }
+    double get_error(int table) const { return errors[table]; }
+    double get_pivots_value(int id_node, int id_goal) const;//the differential heuristic, i.e. max |d(node, p) - d(goal, p)| over the pivots
 };
 
 #endif // HEURISTIC_H
@@ -4,14 +4,57 @@
 #include "task.h"
 #include "cbs.h"
 #include "xml_logger.h"
+#include <atomic>
+#include <thread>
+
+Solution find_portfolio_solution(const Map &map, const Task &task, const std::vector<Config> &configs, const std::vector<std::string> &names)
+{
+    //all the configurations are solved concurrently with the same heuristic, the first found solution cancels the others
+    Heuristic h_values;
+    h_values.init(map.get_size(), configs[0].h_storage, configs[0].pivots, configs[0].lazy_heuristic);
+    Thread_Pool pool;
+    int pool_size = 1;
+    for(auto& c: configs)
+        pool_size = std::max(pool_size, c.threads);
+    pool.init(pool_size);
+    h_values.count(map, task, pool);
+    std::vector<CBS> solvers(configs.size());
+    std::vector<Solution> solutions(configs.size());
+    std::atomic<bool> cancel(false);
+    std::atomic<int> winner(-1);
+    std::vector<std::thread> threads;
+    for(unsigned int k = 0; k < configs.size(); k++)
+        threads.emplace_back([&, k]()
+        {
+            solutions[k] = solvers[k].find_solution(map, task, configs[k], &h_values, &cancel);
+            int none(-1);
+            if(solutions[k].found && winner.compare_exchange_strong(none, int(k)))
+                cancel = true;
+        });
+    for(auto& t: threads)
+        t.join();
+    if(winner < 0)
+        return solutions[0];
+    Solution solution = solutions[winner];
+    solution.config = names[winner];
+    return solution;
+}
 
 int main(int argc, const char *argv[])
 {
     if(argc > 2)
     {
-        Config config;
-        if(argc > 3)
-            config.getConfig(argv[3]);
+        std::vector<Config> configs(std::max(argc - 3, 1));
+        std::vector<std::string> names;
+        for(int i = 3; i < argc; i++)
+        {
+            configs[i - 3].getConfig(argv[i]);
+            names.push_back(argv[i]);
+        }
+        Config config = configs[0];
+        for(auto& c: configs)
+            if(c.agent_size != config.agent_size || c.connectdness != config.connectdness || c.h_storage != config.h_storage || c.pivots != config.pivots || c.lazy_heuristic != config.lazy_heuristic)
+                std::cout<<"Warning! All the configurations of the portfolio share the map and the heuristic, so they use the agent size, connectedness and heuristic options of the first one.\n";
         Map map = Map(config.agent_size, config.connectdness);
         map.get_map(argv[1]);
         Task task;
@@ -20,11 +63,21 @@ int main(int argc, const char *argv[])
             task.make_ij(map);
         else
             task.make_ids(map.get_width());
-        CBS cbs;
-        Solution solution = cbs.find_solution(map, task, config);
+        Solution solution;
+        if(configs.size() > 1)
+            solution = find_portfolio_solution(map, task, configs, names);
+        else
+        {
+            CBS cbs;
+            solution = cbs.find_solution(map, task, config);
+        }
         XML_logger logger;
         std::cout<< "Runtime: "<<solution.time.count() << "\nMakespan: " << solution.makespan << "\nFlowtime:" << solution.flowtime<< "\nInitial Cost: "<<solution.init_cost<< "\nCollision Checking Time: " << solution.check_time
-             << "\nHL expanded: " << solution.high_level_expanded << "\nLL searches: " << solution.low_level_expansions << "\nLL expanded(avg): " << solution.low_level_expanded << std::endl;
+             << "\nHL expanded: " << solution.high_level_expanded << "\nLL searches: " << solution.low_level_expansions << "\nLL expanded(avg): " << solution.low_level_expanded
+             << "\nLL pushed(avg): " << solution.low_level_pushed << "\nLL popped(avg): " << solution.low_level_popped
+             << "\nLL cache hit rate: " << solution.cache_hit_rate << "\nMemory per CT node (bytes): " << solution.memory_per_node << std::endl;
+        if(!solution.config.empty())
+            std::cout << "Portfolio winner: " << solution.config << std::endl;
 
         logger.get_log(argv[2]);
         logger.write_to_log_summary(solution);
@@ -199,6 +199,7 @@ bool Map::get_grid(const char* FileName)
                     v_moves.push_back(Node((i + moves[k].i)*width + moves[k].j + j, 0, 0, i + moves[k].i, j + moves[k].j));
             valid_moves[i*width+j] = v_moves;
         }
+    make_edges();
     return true;
 }
 
@@ -271,6 +272,7 @@ bool Map::get_roadmap(const char *FileName)
         valid_moves.push_back(neighbors);
     }
     size = int(nodes.size());
+    make_edges();
     return true;
 }
 
@@ -305,11 +307,27 @@ bool Map::cell_is_obstacle(int i, int j) const
     return (grid[i][j] == CN_OBSTL);
 }
 
-std::vector<Node> Map::get_valid_moves(int id) const
+const std::vector<Node>& Map::get_valid_moves(int id) const
 {
     return valid_moves[id];
 }
 
+void Map::make_edges()
+{
+    edge_offsets.resize(valid_moves.size() + 1);
+    edge_offsets[0] = 0;
+    for(unsigned int i = 0; i < valid_moves.size(); i++)
+        edge_offsets[i + 1] = edge_offsets[i] + int(valid_moves[i].size());
+}
+
+int Map::get_edge_id(int id1, int id2) const
+{
+    for(unsigned int k = 0; k < valid_moves[id1].size(); k++)
+        if(valid_moves[id1][k].id == id2)
+            return edge_offsets[id1] + int(k);
+    return -1;
+}
+
 bool Map::check_line(int x1, int y1, int x2, int y2)
 {
     int delta_x(std::abs(x1 - x2));
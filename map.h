@@ -17,6 +17,7 @@ private:
     std::vector<std::vector<int>> grid;
     std::vector<gNode> nodes;
     std::vector<std::vector<Node>> valid_moves;
+    std::vector<int> edge_offsets;//CSR offsets, i.e. the id of the k-th edge going out of node v is edge_offsets[v] + k
     int  height, width, size;
     int  connectedness;
     double agent_size;
@@ -24,6 +25,7 @@ private:
     bool check_line(int x1, int y1, int x2, int y2);
     bool get_grid(const char* FileName);
     bool get_roadmap(const char* FileName);
+    void make_edges();
 public:
     Map(double size, int k){ agent_size = size; connectedness = k; }
     ~Map(){}
@@ -33,8 +35,13 @@ public:
     bool cell_is_obstacle(int i, int j) const;
     int  get_width() const {return width;}
     gNode get_gNode(int id) const {if(id < int(nodes.size())) return nodes[id]; return gNode();}
+    double get_i(int id) const { return map_is_roadmap ? nodes[id].i : id/width; }
+    double get_j(int id) const { return map_is_roadmap ? nodes[id].j : id%width; }
     int  get_id(int i, int j) const;
-    std::vector<Node> get_valid_moves(int id) const;
+    const std::vector<Node>& get_valid_moves(int id) const;
+    int  get_edges_size() const { return edge_offsets.empty() ? 0 : edge_offsets.back(); }
+    int  get_first_edge(int id) const { return edge_offsets[id]; }
+    int  get_edge_id(int id1, int id2) const;
     void print_map();
     void printPPM();
 };
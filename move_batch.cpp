@@ -0,0 +1,137 @@
+#include "move_batch.h"
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+Move_Batch::Move_Batch():count(0)
+{
+    //unused lanes are still computed, so they are kept initialized
+    for(int k = 0; k < capacity; k++)
+        t1a[k] = t2a[k] = i1a[k] = j1a[k] = i2a[k] = j2a[k] = t1b[k] = t2b[k] = i1b[k] = j1b[k] = i2b[k] = j2b[k] = 0;
+}
+
+void Move_Batch::add(const Move &move1, const Move &move2)
+{
+    t1a[count] = move1.t1; t2a[count] = move1.t2; i1a[count] = move1.i1; j1a[count] = move1.j1; i2a[count] = move1.i2; j2a[count] = move1.j2;
+    t1b[count] = move2.t1; t2b[count] = move2.t2; i1b[count] = move2.i1; j1b[count] = move2.j1; i2b[count] = move2.i2; j2b[count] = move2.j2;
+    count++;
+}
+
+bool Move_Batch::check_pair(const Move &move1, const Move &move2)
+{
+    double startTimeA(move1.t1), endTimeA(move1.t2), startTimeB(move2.t1), endTimeB(move2.t2);
+    Vector2D A(move1.i1, move1.j1);
+    Vector2D B(move2.i1, move2.j1);
+    Vector2D VA((move1.i2 - move1.i1)/(move1.t2 - move1.t1), (move1.j2 - move1.j1)/(move1.t2 - move1.t1));
+    Vector2D VB((move2.i2 - move2.i1)/(move2.t2 - move2.t1), (move2.j2 - move2.j1)/(move2.t2 - move2.t1));
+    if(startTimeB > startTimeA)
+    {
+        A += VA*(startTimeB-startTimeA);
+        startTimeA = startTimeB;
+    }
+    else if(startTimeB < startTimeA)
+    {
+        B += VB*(startTimeA - startTimeB);
+        startTimeB = startTimeA;
+    }
+    double r(2*CN_AGENT_SIZE);
+    Vector2D w(B - A);
+    double c(w*w - r*r);
+    if(c < 0)
+        return true;
+
+    Vector2D v(VA - VB);
+    double a(v*v);
+    double b(w*v);
+    double dscr(b*b - a*c);
+    if(dscr - CN_EPSILON < 0)
+        return false;
+    double ctime = (b - sqrt(dscr))/a;
+    if(ctime > -CN_EPSILON && ctime < std::min(endTimeB,endTimeA) - startTimeA + CN_EPSILON)
+        return true;
+    return false;
+}
+
+//the vector versions repeat every operation of check_pair in the same order, the branches are replaced by masks
+#if defined(__AVX__)
+unsigned int Move_Batch::check() const
+{
+    const double r(2*CN_AGENT_SIZE);
+    const __m256d zero = _mm256_setzero_pd(), eps = _mm256_set1_pd(CN_EPSILON), neg_eps = _mm256_set1_pd(-CN_EPSILON), rr = _mm256_set1_pd(r*r);
+    __m256d sA = _mm256_load_pd(t1a), eA = _mm256_load_pd(t2a), sB = _mm256_load_pd(t1b), eB = _mm256_load_pd(t2b);
+    __m256d Ai = _mm256_load_pd(i1a), Aj = _mm256_load_pd(j1a), Bi = _mm256_load_pd(i1b), Bj = _mm256_load_pd(j1b);
+    __m256d dtA = _mm256_sub_pd(eA, sA), dtB = _mm256_sub_pd(eB, sB);
+    __m256d VAi = _mm256_div_pd(_mm256_sub_pd(_mm256_load_pd(i2a), Ai), dtA), VAj = _mm256_div_pd(_mm256_sub_pd(_mm256_load_pd(j2a), Aj), dtA);
+    __m256d VBi = _mm256_div_pd(_mm256_sub_pd(_mm256_load_pd(i2b), Bi), dtB), VBj = _mm256_div_pd(_mm256_sub_pd(_mm256_load_pd(j2b), Bj), dtB);
+    __m256d later = _mm256_cmp_pd(sB, sA, _CMP_GT_OQ), earlier = _mm256_cmp_pd(sB, sA, _CMP_LT_OQ);
+    __m256d dA = _mm256_sub_pd(sB, sA), dB = _mm256_sub_pd(sA, sB);
+    Ai = _mm256_blendv_pd(Ai, _mm256_add_pd(Ai, _mm256_mul_pd(VAi, dA)), later);
+    Aj = _mm256_blendv_pd(Aj, _mm256_add_pd(Aj, _mm256_mul_pd(VAj, dA)), later);
+    Bi = _mm256_blendv_pd(Bi, _mm256_add_pd(Bi, _mm256_mul_pd(VBi, dB)), earlier);
+    Bj = _mm256_blendv_pd(Bj, _mm256_add_pd(Bj, _mm256_mul_pd(VBj, dB)), earlier);
+    sA = _mm256_blendv_pd(sA, sB, later);
+    __m256d wi = _mm256_sub_pd(Bi, Ai), wj = _mm256_sub_pd(Bj, Aj);
+    __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(wi, wi), _mm256_mul_pd(wj, wj)), rr);
+    __m256d inside = _mm256_cmp_pd(c, zero, _CMP_LT_OQ);
+    __m256d vi = _mm256_sub_pd(VAi, VBi), vj = _mm256_sub_pd(VAj, VBj);
+    __m256d a = _mm256_add_pd(_mm256_mul_pd(vi, vi), _mm256_mul_pd(vj, vj));
+    __m256d b = _mm256_add_pd(_mm256_mul_pd(wi, vi), _mm256_mul_pd(wj, vj));
+    __m256d dscr = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(a, c));
+    __m256d solvable = _mm256_cmp_pd(_mm256_sub_pd(dscr, eps), zero, _CMP_NLT_UQ);
+    __m256d ctime = _mm256_div_pd(_mm256_sub_pd(b, _mm256_sqrt_pd(dscr)), a);
+    __m256d limit = _mm256_add_pd(_mm256_sub_pd(_mm256_min_pd(eA, eB), sA), eps);
+    __m256d in_time = _mm256_and_pd(_mm256_cmp_pd(ctime, neg_eps, _CMP_GT_OQ), _mm256_cmp_pd(ctime, limit, _CMP_LT_OQ));
+    __m256d result = _mm256_or_pd(inside, _mm256_and_pd(solvable, in_time));
+    return static_cast<unsigned int>(_mm256_movemask_pd(result)) & ((1u << count) - 1);
+}
+#elif defined(__SSE2__)
+static inline __m128d select(__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+unsigned int Move_Batch::check() const
+{
+    const double r(2*CN_AGENT_SIZE);
+    const __m128d zero = _mm_setzero_pd(), eps = _mm_set1_pd(CN_EPSILON), neg_eps = _mm_set1_pd(-CN_EPSILON), rr = _mm_set1_pd(r*r);
+    unsigned int mask(0);
+    for(int k = 0; k < count; k += 2)
+    {
+        __m128d sA = _mm_load_pd(t1a + k), eA = _mm_load_pd(t2a + k), sB = _mm_load_pd(t1b + k), eB = _mm_load_pd(t2b + k);
+        __m128d Ai = _mm_load_pd(i1a + k), Aj = _mm_load_pd(j1a + k), Bi = _mm_load_pd(i1b + k), Bj = _mm_load_pd(j1b + k);
+        __m128d dtA = _mm_sub_pd(eA, sA), dtB = _mm_sub_pd(eB, sB);
+        __m128d VAi = _mm_div_pd(_mm_sub_pd(_mm_load_pd(i2a + k), Ai), dtA), VAj = _mm_div_pd(_mm_sub_pd(_mm_load_pd(j2a + k), Aj), dtA);
+        __m128d VBi = _mm_div_pd(_mm_sub_pd(_mm_load_pd(i2b + k), Bi), dtB), VBj = _mm_div_pd(_mm_sub_pd(_mm_load_pd(j2b + k), Bj), dtB);
+        __m128d later = _mm_cmpgt_pd(sB, sA), earlier = _mm_cmplt_pd(sB, sA);
+        __m128d dA = _mm_sub_pd(sB, sA), dB = _mm_sub_pd(sA, sB);
+        Ai = select(later, _mm_add_pd(Ai, _mm_mul_pd(VAi, dA)), Ai);
+        Aj = select(later, _mm_add_pd(Aj, _mm_mul_pd(VAj, dA)), Aj);
+        Bi = select(earlier, _mm_add_pd(Bi, _mm_mul_pd(VBi, dB)), Bi);
+        Bj = select(earlier, _mm_add_pd(Bj, _mm_mul_pd(VBj, dB)), Bj);
+        sA = select(later, sB, sA);
+        __m128d wi = _mm_sub_pd(Bi, Ai), wj = _mm_sub_pd(Bj, Aj);
+        __m128d c = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(wi, wi), _mm_mul_pd(wj, wj)), rr);
+        __m128d inside = _mm_cmplt_pd(c, zero);
+        __m128d vi = _mm_sub_pd(VAi, VBi), vj = _mm_sub_pd(VAj, VBj);
+        __m128d a = _mm_add_pd(_mm_mul_pd(vi, vi), _mm_mul_pd(vj, vj));
+        __m128d b = _mm_add_pd(_mm_mul_pd(wi, vi), _mm_mul_pd(wj, vj));
+        __m128d dscr = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(a, c));
+        __m128d solvable = _mm_cmpnlt_pd(_mm_sub_pd(dscr, eps), zero);
+        __m128d ctime = _mm_div_pd(_mm_sub_pd(b, _mm_sqrt_pd(dscr)), a);
+        __m128d limit = _mm_add_pd(_mm_sub_pd(_mm_min_pd(eA, eB), sA), eps);
+        __m128d in_time = _mm_and_pd(_mm_cmpgt_pd(ctime, neg_eps), _mm_cmplt_pd(ctime, limit));
+        __m128d result = _mm_or_pd(inside, _mm_and_pd(solvable, in_time));
+        mask |= static_cast<unsigned int>(_mm_movemask_pd(result)) << k;
+    }
+    return mask & ((1u << count) - 1);
+}
+#else
+unsigned int Move_Batch::check() const
+{
+    unsigned int mask(0);
+    for(int k = 0; k < count; k++)
+        if(check_pair(Move(t1a[k], t2a[k], i1a[k], j1a[k], i2a[k], j2a[k]), Move(t1b[k], t2b[k], i1b[k], j1b[k], i2b[k], j2b[k])))
+            mask |= 1u << k;
+    return mask;
+}
+#endif
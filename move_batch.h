@@ -0,0 +1,32 @@
+#ifndef MOVE_BATCH_H
+#define MOVE_BATCH_H
+#include "structs.h"
+
+class Move_Batch //pairs of moves stored as structure-of-arrays, so that their collisions are checked at once by SIMD instructions
+{
+public:
+    static const int capacity = 4;
+    Move_Batch();
+    void add(const Move &move1, const Move &move2);
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool full() const { return count == capacity; }
+    unsigned int check() const;//the k-th bit is set if the moves of the k-th pair collide
+    static bool check_pair(const Move &move1, const Move &move2);//scalar version of the check, its results are exactly the same
+private:
+    alignas(32) double t1a[capacity];
+    alignas(32) double t2a[capacity];
+    alignas(32) double i1a[capacity];
+    alignas(32) double j1a[capacity];
+    alignas(32) double i2a[capacity];
+    alignas(32) double j2a[capacity];
+    alignas(32) double t1b[capacity];
+    alignas(32) double t2b[capacity];
+    alignas(32) double i1b[capacity];
+    alignas(32) double j1b[capacity];
+    alignas(32) double i2b[capacity];
+    alignas(32) double j2b[capacity];
+    int count;
+};
+
+#endif // MOVE_BATCH_H
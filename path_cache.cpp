@@ -0,0 +1,77 @@
+#include "path_cache.h"
+
+void Path_Cache::set_capacity(unsigned int _capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = _capacity;
+    while(entries.size() > capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+Cache_Key Path_Cache::get_key(int agent, const std::list<Constraint> &cons) const
+{
+    Cache_Key key;
+    key.agent = agent;
+    key.cons.reserve(cons.size());
+    for(auto& c: cons)
+        key.cons.emplace_back(c.t1, c.t2, c.id1, c.id2, c.positive);
+    std::sort(key.cons.begin(), key.cons.end());
+    key.hash = std::hash<int>()(agent);
+    auto combine = [&key](std::size_t h){ key.hash ^= h + 0x9e3779b9 + (key.hash << 6) + (key.hash >> 2); };
+    for(auto& c: key.cons)
+    {
+        combine(std::hash<double>()(std::get<0>(c)));
+        combine(std::hash<double>()(std::get<1>(c)));
+        combine(std::hash<int>()(std::get<2>(c)));
+        combine(std::hash<int>()(std::get<3>(c)));
+        combine(std::hash<bool>()(std::get<4>(c)));
+    }
+    return key;
+}
+
+bool Path_Cache::find(const Cache_Key &key, Path &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if(it == index.end())
+    {
+        misses++;
+        return false;
+    }
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    path = it->second->second;
+    return true;
+}
+
+void Path_Cache::insert(const Cache_Key &key, const Path &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(capacity == 0 || index.count(key) > 0)
+        return;
+    entries.emplace_front(key, path);
+    index.insert({key, entries.begin()});
+    if(entries.size() > capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void Path_Cache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    hits = 0;
+    misses = 0;
+}
+
+double Path_Cache::get_hit_rate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return double(hits)/std::max(hits + misses, 1ul);
+}
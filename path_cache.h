@@ -0,0 +1,44 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+#include "structs.h"
+#include "const.h"
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+struct Cache_Key
+{
+    int agent;
+    std::vector<std::tuple<double, double, int, int, bool>> cons;//sorted (t1, t2, id1, id2, positive) of all the constraints
+    std::size_t hash;
+    bool operator ==(const Cache_Key& other) const
+    {
+        return hash == other.hash && agent == other.agent && cons == other.cons;
+    }
+};
+
+struct Cache_Key_Hash
+{
+    std::size_t operator()(const Cache_Key& key) const { return key.hash; }
+};
+
+class Path_Cache //LRU cache of low-level paths, shared by all the planners
+{
+public:
+    Path_Cache(unsigned int _capacity = CN_CACHE_SIZE):capacity(_capacity), hits(0), misses(0) {}
+    void set_capacity(unsigned int _capacity);
+    Cache_Key get_key(int agent, const std::list<Constraint> &cons) const;
+    bool find(const Cache_Key &key, Path &path);
+    void insert(const Cache_Key &key, const Path &path);
+    void clear();
+    double get_hit_rate();
+private:
+    unsigned int capacity;
+    std::list<std::pair<Cache_Key, Path>> entries;//the most recently used entry goes first
+    std::unordered_map<Cache_Key, std::list<std::pair<Cache_Key, Path>>::iterator, Cache_Key_Hash> index;
+    unsigned long hits, misses;
+    std::mutex mutex;
+};
+
+#endif // PATH_CACHE_H
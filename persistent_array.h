@@ -0,0 +1,34 @@
+#ifndef PERSISTENT_ARRAY_H
+#define PERSISTENT_ARRAY_H
+#include <memory>
+#include <vector>
+
+template<typename T>
+class Persistent_Array //fixed-size array whose copies share all the chunks that haven't been changed after copying
+{
+public:
+    Persistent_Array(unsigned int _size = 0):count(_size)
+    {
+        for(unsigned int i = 0; i < count; i += chunk_size)
+            chunks.push_back(std::make_shared<const std::vector<T>>(std::min(chunk_size, count - i)));
+    }
+    unsigned int size() const { return count; }
+    std::size_t get_memory() const { return chunks.capacity()*sizeof(chunks[0]) + chunk_size*sizeof(T); }//owned by a copy with one changed chunk
+    const T& operator[](unsigned int i) const { return (*chunks[i/chunk_size])[i%chunk_size]; }
+    void set(unsigned int i, T value)
+    {
+        //chunks are immutable, so the changed one is copied and the others stay shared
+        auto chunk = std::make_shared<std::vector<T>>(*chunks[i/chunk_size]);
+        (*chunk)[i%chunk_size] = std::move(value);
+        chunks[i/chunk_size] = std::move(chunk);
+    }
+private:
+    static const unsigned int chunk_size = 16;
+    std::vector<std::shared_ptr<const std::vector<T>>> chunks;
+    unsigned int count;
+};
+
+template<typename T>
+const unsigned int Persistent_Array<T>::chunk_size;
+
+#endif // PERSISTENT_ARRAY_H
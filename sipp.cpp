@@ -3,10 +3,14 @@
 void SIPP::clear()
 {
     open.clear();
+    open.reset_stats();
     close.clear();
     collision_intervals.clear();
+    safe_intervals.clear();
     landmarks.clear();
-    constraints.clear();
+    for(auto edge_id: constrained_edges)
+        move_constraints[edge_id].clear();
+    constrained_edges.clear();
     visited.clear();
     path.cost = -1;
 }
@@ -16,70 +20,65 @@ double SIPP::dist(const Node& a, const Node& b)
     return std::sqrt(pow(a.i - b.i, 2) + pow(a.j - b.j, 2));
 }
 
-void SIPP::find_successors(Node curNode, const Map &map, std::list<Node> &succs, Heuristic &h_values, Node goal)
+void SIPP::find_successors(Node curNode, const Map &map, std::list<Node> &succs, const Heuristic &h_values, Node goal)
 {
     Node newNode;
-    std::vector<Node> valid_moves = map.get_valid_moves(curNode.id);
+    const std::vector<Node> &valid_moves = map.get_valid_moves(curNode.id);
+    int edge_id = map.get_first_edge(curNode.id);
     for(auto move : valid_moves)
     {
+        bool constrained = !move_constraints[edge_id].empty();
+        edge_id++;
         newNode.i = move.i;
         newNode.j = move.j;
         newNode.id = move.id;
         double cost = dist(curNode, newNode);
         newNode.g = curNode.g + cost;
-        std::vector<std::pair<double, double>> intervals(0);
-        auto colls_it = collision_intervals.find(newNode.id);
-        if(colls_it != collision_intervals.end())
+        const std::vector<std::pair<double, double>>* intervals = &default_intervals;
+        auto safe_it = safe_intervals.find(newNode.id);
+        if(safe_it != safe_intervals.end())
+            intervals = &safe_it->second;
+        //intervals that end before the earliest arrival time can't be reached, so skip them
+        auto first = std::lower_bound(intervals->begin(), intervals->end(), newNode.g,
+                                      [](const std::pair<double, double>& interval, double g){ return interval.second < g; });
+        for(auto interval_it = first; interval_it != intervals->end(); interval_it++)
         {
-            std::pair<double, double> interval = {0, CN_INFINITY};
-            for(unsigned int i = 0; i < colls_it->second.size(); i++)
-            {
-                interval.second = colls_it->second[i].first;
-                intervals.push_back(interval);
-                interval.first = colls_it->second[i].second;
-            }
-            interval.second = CN_INFINITY;
-            intervals.push_back(interval);
-        }
-        else
-            intervals.push_back({0, CN_INFINITY});
-        auto cons_it = constraints.find({curNode.id, newNode.id});
-        int id(0);
-        for(auto interval: intervals)
-        {
-            newNode.interval_id = id;
-            id++;
+            auto interval = *interval_it;
+            if(interval.first - cost > curNode.interval.second) //this and all the next intervals can't be reached before the current one ends
+                break;
+            newNode.interval_id = int(interval_it - intervals->begin());
             auto it = visited.find(newNode.id + newNode.interval_id * map.get_size());
-            if(it != visited.end())
-                if(it->second.second)
+            if(it != nullptr)
+                if(it->closed)
                     continue;
             if(interval.second < newNode.g)
                 continue;
             if(interval.first > newNode.g)
                 newNode.g = interval.first;
-            if(cons_it != constraints.end())
-                for(unsigned int i = 0; i < cons_it->second.size(); i++)
-                    if(newNode.g - cost + CN_EPSILON > cons_it->second[i].t1 && newNode.g - cost < cons_it->second[i].t2)
-                        newNode.g = cons_it->second[i].t2 + cost;
+            if(constrained)
+            {
+                double departure = get_departure(edge_id - 1, newNode.g - cost);
+                if(departure != newNode.g - cost)
+                    newNode.g = departure + cost;
+            }
             newNode.interval = interval;
             if(newNode.g - cost > curNode.interval.second || newNode.g > newNode.interval.second)
                 continue;
-            if(it != visited.end())
+            if(it != nullptr)
             {
-                if(it->second.first - CN_EPSILON < newNode.g)
+                if(it->g - CN_EPSILON < newNode.g)
                     continue;
                 else
-                    it->second.first = newNode.g;
+                    it->g = newNode.g;
             }
             else
-                visited.insert({newNode.id + newNode.interval_id * map.get_size(), {newNode.g, false}});
+                visited.insert(newNode.id + newNode.interval_id * map.get_size(), newNode.g);
             if(goal.id == agent.goal_id) //perfect heuristic is known
                 newNode.f = newNode.g + h_values.get_value(newNode.id, agent.id);
             else
             {
                 double h = sqrt(pow(goal.i - newNode.i, 2) + pow(goal.j - newNode.j, 2));
-                for(unsigned int i = 0; i < h_values.get_size(); i++) //differential heuristic with pivots placed to agents goals
-                    h = std::max(h, fabs(h_values.get_value(newNode.id, i) - h_values.get_value(goal.id, i)));
+                h = std::max(h, h_values.get_pivots_value(newNode.id, goal.id)); //differential heuristic with pivots placed to agents goals
                 newNode.f = newNode.g + h;
             }
             succs.push_back(newNode);
@@ -89,33 +88,12 @@ void SIPP::find_successors(Node curNode, const Map &map, std::list<Node> &succs,
 
 Node SIPP::find_min()
 {
-    Node min = *open.begin();
-    open.pop_front();
-    return min;
+    return open.pop();
 }
 
-void SIPP::add_open(Node newNode)
+void SIPP::add_open(Node newNode, const Map &map)
 {
-    if (open.empty() || open.back().f - CN_EPSILON < newNode.f)
-    {
-        open.push_back(newNode);
-        return;
-    }
-    for(auto iter = open.begin(); iter != open.end(); ++iter)
-    {
-        if(iter->f > newNode.f + CN_EPSILON) // if newNode.f has lower f-value
-        {
-            open.insert(iter, newNode);
-            return;
-        }
-        else if(fabs(iter->f - newNode.f) < CN_EPSILON && newNode.g + CN_EPSILON > iter->g) // if f-values are equal, compare g-values
-        {
-            open.insert(iter, newNode);
-            return;
-        }
-    }
-    open.push_back(newNode);
-    return;
+    open.push(newNode, newNode.id + newNode.interval_id * map.get_size());
 }
 
 std::vector<Node> SIPP::reconstruct_path(Node curNode)
@@ -161,63 +139,42 @@ void SIPP::add_collision_interval(int id, std::pair<double, double> interval)
         }
 }
 
-void SIPP::add_move_constraint(Move move)
+void SIPP::add_move_constraint(int edge_id, std::pair<double, double> interval)
 {
-    std::vector<Move> m_cons(0);
-    if(constraints.count({move.id1, move.id2}) == 0)
-        constraints.insert({{move.id1, move.id2}, {move}});
-    else
+    std::vector<std::pair<double, double>> &intervals = move_constraints[edge_id];
+    if(intervals.empty())
+        constrained_edges.push_back(edge_id);
+    //intervals are kept sorted and merged, i.e. each one starts at least CN_EPSILON later than the previous one ends
+    auto first = std::lower_bound(intervals.begin(), intervals.end(), interval.first,
+                                  [](const std::pair<double, double>& i, double t){ return i.second + CN_EPSILON <= t; });
+    auto last = first;
+    while(last != intervals.end() && last->first < interval.second + CN_EPSILON)
     {
-        m_cons = constraints.at({move.id1, move.id2});
-        bool inserted(false);
-        for(unsigned int i = 0; i < m_cons.size(); i++)
-        {
-            if(inserted)
-                break;
-            if(m_cons[i].t1 > move.t1)
-            {
-                if(m_cons[i].t1 < move.t2 + CN_EPSILON)
-                {
-                    m_cons[i].t1 = move.t1;
-                    if(move.t2 + CN_EPSILON > m_cons[i].t2)
-                        m_cons[i].t2 = move.t2;
-                    inserted = true;
-                    if(i != 0)
-                        if(m_cons[i-1].t2 + CN_EPSILON > move.t1 && m_cons[i-1].t2 < move.t2 + CN_EPSILON)
-                        {
-                            m_cons[i-1].t2 = move.t2;
-                            if(m_cons[i-1].t2 + CN_EPSILON > m_cons[i].t1 && m_cons[i-1].t2 < m_cons[i].t2 + CN_EPSILON)
-                            {
-                                m_cons[i-1].t2 = m_cons[i].t2;
-                                m_cons.erase(m_cons.begin() + i);
-                            }
-                            inserted = true;
-                        }
-                }
-                else
-                {
-                    if(i != 0)
-                        if(m_cons[i-1].t2 + CN_EPSILON > move.t1 && m_cons[i-1].t2 < move.t2 + CN_EPSILON)
-                        {
-                            m_cons[i-1].t2 = move.t2;
-                            inserted = true;
-                            break;
-                        }
-                    m_cons.insert(m_cons.begin() + i, move);
-                    inserted = true;
-                }
-            }
-        }
-        if(m_cons.back().t2 + CN_EPSILON > move.t1 && m_cons.back().t2 < move.t2 + CN_EPSILON)
-            m_cons.back().t2 = move.t2;
-        else if(!inserted)
-            m_cons.push_back(move);
-        constraints.at({move.id1, move.id2}) = m_cons;
+        interval.first = std::min(interval.first, last->first);
+        interval.second = std::max(interval.second, last->second);
+        last++;
     }
+    first = intervals.erase(first, last);
+    intervals.insert(first, interval);
+}
+
+double SIPP::get_departure(int edge_id, double t)
+{
+    const std::vector<std::pair<double, double>> &intervals = move_constraints[edge_id];
+    if(intervals.empty())
+        return t;
+    //the only interval that can prohibit the departure at t is the first one that ends after t
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), t,
+                               [](double t, const std::pair<double, double>& i){ return t < i.second; });
+    if(it != intervals.end() && t + CN_EPSILON > it->first)
+        return it->second;
+    return t;
 }
 
-void SIPP::make_constraints(std::list<Constraint> &cons)
+void SIPP::make_constraints(std::list<Constraint> &cons, const Map &map)
 {
+    if(int(move_constraints.size()) < map.get_edges_size())
+        move_constraints.resize(map.get_edges_size());
     for(auto con : cons)
     {
         if(con.positive == false)
@@ -225,7 +182,11 @@ void SIPP::make_constraints(std::list<Constraint> &cons)
             if(con.id1 == con.id2) // wait consatraint
                 add_collision_interval(con.id1, std::make_pair(con.t1, con.t2));
             else
-                add_move_constraint(Move(con));
+            {
+                int edge_id = map.get_edge_id(con.id1, con.id2);
+                if(edge_id >= 0)
+                    add_move_constraint(edge_id, std::make_pair(con.t1, con.t2));
+            }
         }
         else
         {
@@ -241,6 +202,25 @@ void SIPP::make_constraints(std::list<Constraint> &cons)
                 landmarks.push_back(Move(con.t1, con.t2, con.i1, con.j1, con.i2, con.j2, con.id1, con.id2));
         }
     }
+    make_safe_intervals();
+}
+
+void SIPP::make_safe_intervals()
+{
+    for(auto& c: collision_intervals)
+    {
+        std::vector<std::pair<double, double>>& intervals = safe_intervals[c.first];
+        intervals.reserve(c.second.size() + 1);
+        std::pair<double, double> interval = {0, CN_INFINITY};
+        for(unsigned int i = 0; i < c.second.size(); i++)
+        {
+            interval.second = c.second[i].first;
+            intervals.push_back(interval);
+            interval.first = c.second[i].second;
+        }
+        interval.second = CN_INFINITY;
+        intervals.push_back(interval);
+    }
 }
 
 Path SIPP::add_part(Path result, Path part)
@@ -251,29 +231,37 @@ Path SIPP::add_part(Path result, Path part)
     return result;
 }
 
-std::vector<Path> SIPP::find_partial_path(std::vector<Node> starts, std::vector<Node> goals, const Map &map, Heuristic &h_values, double max_f)
+std::vector<Path> SIPP::find_partial_path(std::vector<Node> starts, std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f)
 {
     open.clear();
     close.clear();
     path.cost = -1;
     visited.clear();
-    std::vector<Path> paths(goals.size());
-    int pathFound(0);
+    reused = 0;
+    pruned_f = CN_INFINITY;
     for(auto s:starts)
     {
         s.parent = nullptr;
-        open.push_back(s);
-        visited.insert({s.id + s.interval_id * map.get_size(), {s.g, false}});
+        if(visited.insert(s.id + s.interval_id * map.get_size(), s.g))
+            add_open(s, map);
     }
+    return expand(goals, map, h_values, max_f);
+}
+
+std::vector<Path> SIPP::expand(std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f)
+{
+    std::vector<Path> paths(goals.size());
+    int pathFound(0);
     Node curNode;
     while(!open.empty())
     {
         curNode = find_min();
         auto v = visited.find(curNode.id + curNode.interval_id * map.get_size());
-        if(v->second.second)
+        if(v->closed)
             continue;
-        v->second.second = true;
-        auto parent = &close.insert({curNode.id + curNode.interval_id * map.get_size(), curNode}).first->second;
+        v->closed = true;
+        v->index = int(close.size());
+        auto parent = close.add(curNode);
         if(curNode.id == goals[0].id)
         {
             for(unsigned int i = 0; i < goals.size(); i++)
@@ -286,7 +274,9 @@ std::vector<Path> SIPP::find_partial_path(std::vector<Node> starts, std::vector<
                         paths[i].nodes.push_back(curNode);
                     }
                     paths[i].cost = curNode.g;
-                    paths[i].expanded = int(close.size());
+                    paths[i].expanded = int(close.size()) - reused;
+                    paths[i].pushed = open.get_pushes();
+                    paths[i].popped = open.get_pops();
                     pathFound++;
                 }
             if(pathFound == int(goals.size()))
@@ -300,11 +290,12 @@ std::vector<Path> SIPP::find_partial_path(std::vector<Node> starts, std::vector<
         {
             if(it->f > max_f)
             {
+                pruned_f = std::min(pruned_f, it->f);
                 it++;
                 continue;
             }
             it->parent = parent;
-            add_open(*it);
+            add_open(*it, map);
             it++;
         }
     }
@@ -358,29 +349,27 @@ std::vector<Node> SIPP::get_endpoints(int node_id, double node_i, double node_j,
     return nodes;
 }
 
-double SIPP::check_endpoint(Node start, Node goal)
+double SIPP::check_endpoint(Node start, Node goal, const Map &map)
 {
     double cost = sqrt(pow(start.i - goal.i, 2) + pow(start.j - goal.j, 2));
     if(start.g + cost < goal.interval.first)
         start.g = goal.interval.first - cost;
-    if(constraints.count({start.id, goal.id}) != 0)
-    {
-        auto it = constraints.find({start.id, goal.id});
-        for(unsigned int i = 0; i < it->second.size(); i++)
-            if(start.g + CN_EPSILON > it->second[i].t1 && start.g < it->second[i].t2)
-                start.g = it->second[i].t2;
-    }
+    int edge_id = map.get_edge_id(start.id, goal.id);
+    if(edge_id >= 0)
+        start.g = get_departure(edge_id, start.g);
     if(start.g > start.interval.second || start.g + cost > goal.interval.second)
         return CN_INFINITY;
     else
         return start.g + cost;
 }
 
-Path SIPP::find_path(Agent agent, const Map &map, std::list<Constraint> cons, Heuristic &h_values)
+Path SIPP::find_path(Agent agent, const Map &map, std::list<Constraint> cons, const Heuristic &h_values, double max_cost)
 {
     this->clear();
     this->agent = agent;
-    make_constraints(cons);
+    if(int(records.size()) <= agent.id)
+        records.resize(agent.id + 1);
+    make_constraints(cons, map);
 
     std::vector<Node> starts, goals;
     std::vector<Path> parts, results, new_results;
@@ -447,7 +436,7 @@ Path SIPP::find_path(Agent agent, const Map &map, std::list<Constraint> cons, He
                     int best_start_id = -1;
                     for(unsigned int j = 0; j < starts.size(); j++)
                     {
-                        double g = check_endpoint(starts[j], goals[k]);
+                        double g = check_endpoint(starts[j], goals[k], map);
                         if(g < best_g)
                         {
                             best_start_id = j;
@@ -489,14 +478,174 @@ Path SIPP::find_path(Agent agent, const Map &map, std::list<Constraint> cons, He
     {
         starts = {get_endpoints(agent.start_id, agent.start_i, agent.start_j, 0, CN_INFINITY).at(0)};
         goals = {get_endpoints(agent.goal_id, agent.goal_i, agent.goal_j, 0, CN_INFINITY).back()};
-        parts = find_partial_path(starts, goals, map, h_values);
-        expanded = int(close.size());
+        auto base = records[agent.id].end();
+        double limit(0);
+        if(incremental)
+            for(auto it = records[agent.id].begin(); it != records[agent.id].end(); it++)
+            {
+                double l = get_reuse_limit(*it);
+                if(l > limit)
+                {
+                    limit = l;
+                    base = it;
+                }
+            }
+        if(base != records[agent.id].end())
+        {
+            records[agent.id].splice(records[agent.id].begin(), records[agent.id], base);
+            parts = repair_path(records[agent.id].front(), limit, starts, goals, map, h_values, max_cost);
+        }
+        else
+            parts = find_partial_path(starts, goals, map, h_values, max_cost);
+        expanded = int(close.size()) - reused;
         if(parts[0].cost < 0)
-            return Path();
+        {
+            if(pruned_f == CN_INFINITY)
+                return Path();
+            //the bounded search has proved that any path costs more than max_cost, so only the lower bound of its cost is returned, without nodes
+            Path bound({}, pruned_f, agent.id);
+            bound.expanded = expanded;
+            bound.pushed = open.get_pushes();
+            bound.popped = open.get_pops();
+            return bound;
+        }
         result = parts[0];
+        if(incremental)
+            save_record(map);
     }
     result.cost = result.nodes.back().g;
     result.agentID = agent.id;
     result.expanded = expanded;
+    result.pushed = open.get_pushes();
+    result.popped = open.get_pops();
     return result;
 }
+
+void SIPP::set_incremental(bool use_incremental)
+{
+    incremental = use_incremental;
+    records.clear();
+}
+
+double SIPP::first_difference(const std::vector<std::pair<double, double>> &a, const std::vector<std::pair<double, double>> &b)
+{
+    unsigned int k(0);
+    for(; k < a.size() && k < b.size(); k++)
+    {
+        if(a[k].first != b[k].first)
+            return std::min(a[k].first, b[k].first);
+        if(a[k].second != b[k].second)
+            return std::min(a[k].second, b[k].second);
+    }
+    if(k < a.size())
+        return a[k].first;
+    if(k < b.size())
+        return b[k].first;
+    return CN_INFINITY;
+}
+
+double SIPP::get_reuse_limit(const SIPP_Record &record)
+{
+    //before the returned moment of time both searches have exactly the same safe intervals and allowed departures
+    std::vector<std::pair<double, double>> none;
+    double limit(CN_INFINITY);
+    for(auto& c: record.collision_intervals)
+    {
+        auto it = collision_intervals.find(c.first);
+        limit = std::min(limit, first_difference(c.second, it == collision_intervals.end() ? none : it->second));
+    }
+    for(auto& c: collision_intervals)
+        if(record.collision_intervals.count(c.first) == 0)
+            limit = std::min(limit, first_difference(none, c.second));
+    for(auto& m: record.move_constraints)
+        limit = std::min(limit, first_difference(m.second, move_constraints[m.first]) - CN_EPSILON);
+    for(auto edge_id: constrained_edges)
+        if(record.move_constraints.count(edge_id) == 0)
+            limit = std::min(limit, first_difference(none, move_constraints[edge_id]) - CN_EPSILON);
+    return limit - CN_EPSILON;
+}
+
+void SIPP::save_record(const Map &map)
+{
+    std::list<SIPP_Record> &agent_records = records[agent.id];
+    if(agent_records.size() >= CN_SIPP_RECORDS)
+        agent_records.pop_back();
+    agent_records.emplace_front();
+    SIPP_Record &record = agent_records.front();
+    record.collision_intervals = collision_intervals;
+    for(auto edge_id: constrained_edges)
+        record.move_constraints[edge_id] = move_constraints[edge_id];
+    record.nodes.reserve(close.size());
+    record.parents.reserve(close.size());
+    for(unsigned int k = 0; k < close.size(); k++)
+    {
+        const Node &node = close[k];
+        record.nodes.push_back(node);
+        if(node.parent == nullptr)
+            record.parents.push_back(-1);
+        else
+            record.parents.push_back(visited.find(node.parent->id + node.parent->interval_id * map.get_size())->index);
+    }
+}
+
+std::vector<Path> SIPP::repair_path(const SIPP_Record &record, double limit, std::vector<Node> starts, std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f)
+{
+    open.clear();
+    close.clear();
+    path.cost = -1;
+    visited.clear();
+    pruned_f = CN_INFINITY;
+    //all the nodes that were reached before the limit keep their optimal g-values, so they are restored as closed ones
+    std::vector<Node*> restored(record.nodes.size(), nullptr);
+    for(unsigned int k = 0; k < record.nodes.size(); k++)
+    {
+        Node node = record.nodes[k];
+        if(node.g > limit)
+            continue;
+        if(record.parents[k] < 0)
+        {
+            node = starts[0];
+            node.parent = nullptr;
+        }
+        else
+        {
+            if(restored[record.parents[k]] == nullptr)
+                continue;
+            node.parent = restored[record.parents[k]];
+            auto safe_it = safe_intervals.find(node.id);
+            node.interval = safe_it == safe_intervals.end() ? default_intervals[0] : safe_it->second[node.interval_id];
+        }
+        int key = node.id + node.interval_id * map.get_size();
+        visited.insert(key, node.g);
+        if(node.id == goals[0].id) //goal nodes are only put to OPEN to be checked by the regular search, their successors are generated again then
+        {
+            add_open(node, map);
+            continue;
+        }
+        auto v = visited.find(key);
+        restored[k] = close.add(node);
+        v->closed = true;
+        v->index = int(close.size()) - 1;
+    }
+    reused = int(close.size());
+    if(reused == 0)
+        return find_partial_path(starts, goals, map, h_values, max_f);
+    Node goal(goals[0].id, 0, 0, goals[0].i, goals[0].j);
+    for(int k = 0; k < reused; k++)
+    {
+        Node* node = &close[k];
+        std::list<Node> succs;
+        find_successors(*node, map, succs, h_values, goal);
+        for(auto& s: succs)
+        {
+            if(s.f > max_f)
+            {
+                pruned_f = std::min(pruned_f, s.f);
+                continue;
+            }
+            s.parent = node;
+            add_open(s, map);
+        }
+    }
+    return expand(goals, map, h_values, max_f);
+}
@@ -11,32 +11,47 @@ class SIPP
 public:
 
     SIPP()  {}
-    ~SIPP() {}
-    Path find_path(Agent agent, const Map &map, std::list<Constraint> cons, Heuristic &h_values);
+    //if no path costs at most max_cost, the returned one has no nodes and its cost is a lower bound of the optimal one
+    Path find_path(Agent agent, const Map &map, std::list<Constraint> cons, const Heuristic &h_values, double max_cost = CN_INFINITY);
+    void set_incremental(bool use_incremental);
 
 private:
     Agent agent;
-    std::vector<Path> find_partial_path(std::vector<Node> starts, std::vector<Node> goals, const Map &map, Heuristic &h_values, double max_f = CN_INFINITY);
+    std::vector<Path> find_partial_path(std::vector<Node> starts, std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f = CN_INFINITY);
+    std::vector<Path> expand(std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f);
+    std::vector<Path> repair_path(const SIPP_Record &record, double limit, std::vector<Node> starts, std::vector<Node> goals, const Map &map, const Heuristic &h_values, double max_f = CN_INFINITY);
+    double get_reuse_limit(const SIPP_Record &record);
+    double first_difference(const std::vector<std::pair<double, double>> &a, const std::vector<std::pair<double, double>> &b);
+    void save_record(const Map &map);
     Path add_part(Path result, Path part);
-    void find_successors(Node curNode, const Map &map, std::list<Node> &succs, Heuristic &h_values, Node goal);
-    void add_open(Node newNode);
+    void find_successors(Node curNode, const Map &map, std::list<Node> &succs, const Heuristic &h_values, Node goal);
+    void add_open(Node newNode, const Map &map);
     Node find_min();
     double dist(const Node& a, const Node& b);
     std::vector<Node> reconstruct_path(Node curNode);
-    void make_constraints(std::list<Constraint> &cons);
+    void make_constraints(std::list<Constraint> &cons, const Map &map);
+    void make_safe_intervals();
     void clear();
     void add_collision_interval(int id, std::pair<double, double> interval);
-    void add_move_constraint(Move move);
+    void add_move_constraint(int edge_id, std::pair<double, double> interval);
+    double get_departure(int edge_id, double t);
     std::vector<Node> get_endpoints(int node_id, double node_i, double node_j, double t1, double t2);
-    double check_endpoint(Node start, Node goal);
+    double check_endpoint(Node start, Node goal, const Map &map);
 
-    std::unordered_map<int, Node> close;
-    std::list<Node> open;
-    std::unordered_map<int, std::pair<double, bool>> visited;
-    std::map<std::pair<int, int>, std::vector<Move>> constraints;//stores sets of constraints associated with moves
+    Node_Arena close;
+    Open_Heap open;
+    Visited_Table visited;
+    std::vector<std::vector<std::pair<double, double>>> move_constraints;//stores prohibited departure intervals of moves, indexed by the CSR edge id
+    std::vector<int> constrained_edges;
     std::unordered_map<int, std::vector<std::pair<double, double>>> collision_intervals;//stores sets of collision intervals associated with cells
+    std::unordered_map<int, std::vector<std::pair<double, double>>> safe_intervals;//sorted safe intervals of the constrained cells, built once per search
+    std::vector<std::pair<double, double>> default_intervals = {{0, CN_INFINITY}};//the only safe interval of an unconstrained cell
     std::vector<Move> landmarks;
     Path path;
+    bool incremental = false;
+    int reused = 0;//number of closed nodes taken from the previous search
+    double pruned_f = CN_INFINITY;//the least f-value of the nodes pruned by max_f, it bounds the cost of the path from below
+    std::vector<std::list<SIPP_Record>> records;//the latest searches of each agent, the most recently used one goes first
 };
 
 #endif // SIPP_H
@@ -3,12 +3,16 @@
 #include <math.h>
 #include <vector>
 #include <list>
+#include <deque>
 #include <iostream>
 #include <chrono>
 #include "const.h"
+#include "persistent_array.h"
 #include <memory>
 #include <set>
+#include <unordered_map>
 #include <iterator>
+#include <algorithm>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
@@ -65,8 +69,11 @@ struct Path
     double cost;
     int agentID;
     int expanded;
+    int pushed;
+    int popped;
+    bool cached; //the path was taken from the cache of the low-level searches, so it isn't counted in their statistics
     Path(std::vector<Node> _nodes = std::vector<Node>(0), double _cost = -1, int _agentID = -1)
-        : nodes(_nodes), cost(_cost), agentID(_agentID) {expanded = 0;}
+        : nodes(_nodes), cost(_cost), agentID(_agentID) {expanded = 0; pushed = 0; popped = 0; cached = false;}
 };
 
 struct Constraint
@@ -97,6 +104,7 @@ struct Move
     Move(double _t1 = -1, double _t2 = -1, double _i1 = -1, double _j1 = -1, double _i2 = -1, double _j2 = -1, int _id1 = -1, int _id2 = -1)
         : t1(_t1), t2(_t2), i1(_i1), j1(_j1), i2(_i2), j2(_j2), id1(_id1), id2(_id2) {}
     Move(const Move& move) : t1(move.t1), t2(move.t2), i1(move.i1), j1(move.j1), i2(move.i2), j2(move.j2), id1(move.id1), id2(move.id2) {}
+    Move& operator=(const Move&) = default;
     Move(const Constraint& con) : t1(con.t1), t2(con.t2), i1(con.i1), j1(con.j1), i2(con.i2), j2(con.j2), id1(con.id1), id2(con.id2) {}
     Move(Node a, Node b) : t1(a.g), t2(b.g), i1(a.i), j1(a.j), i2(b.i), j2(b.j), id1(a.id), id2(b.id) {}
     bool operator <(const Move& other) const
@@ -125,7 +133,7 @@ struct Conflict
     Move move1, move2;
     double overcost;
     int type;
-    Path path1, path2;
+    std::shared_ptr<const Path> path1, path2;//paths found for the constraints of the conflict while classifying it
     Conflict(int _agent1 = -1, int _agent2 = -1, Move _move1 = Move(), Move _move2 = Move(), double _t = CN_INFINITY)
         : agent1(_agent1), agent2(_agent2), t(_t), move1(_move1), move2(_move2) {overcost = 0; type = 0;}
     bool operator < (const Conflict& other)
@@ -134,9 +142,28 @@ struct Conflict
     }
 };
 
+struct Constraint_Cell //cell of the persistent list of an agent's constraints, shared by all the descendants of the CT node that added it
+{
+    Constraint constraint;
+    std::shared_ptr<const Constraint_Cell> next;
+    Constraint_Cell(Constraint _constraint, std::shared_ptr<const Constraint_Cell> _next):constraint(_constraint), next(_next) {}
+};
+typedef std::shared_ptr<const Constraint_Cell> Constraint_List;
+typedef std::vector<std::shared_ptr<const Conflict>> Conflict_List;//the conflicts that don't involve the replanned agent are shared with the parent
+
+struct Conflict_Order //the classified conflicts are kept sorted by it, so the one to split on (the largest overcost or, if there is none, the latest) is at the back
+{
+    bool operator()(const std::shared_ptr<const Conflict> &a, const std::shared_ptr<const Conflict> &b) const
+    {
+        if(a->overcost > 0 || b->overcost > 0)
+            return a->overcost < b->overcost;
+        return a->t < b->t;
+    }
+};
+
 struct CBS_Node
 {
-    std::vector<Path> paths;
+    Persistent_Array<std::shared_ptr<const Path>> paths;//paths of all the agents, shared with the parent except the replanned one
     CBS_Node* parent;
     Constraint constraint;
     Constraint positive_constraint;
@@ -149,32 +176,67 @@ struct CBS_Node
     bool look_for_cardinal;
     unsigned int total_cons;
     unsigned int low_level_expanded;
-    std::list<Conflict> conflicts;
-    std::list<Conflict> semicard_conflicts;
-    std::list<Conflict> cardinal_conflicts;
+    std::size_t conflicts_memory;//the memory of the conflicts charged when the node was added to the tree, so exactly it is released when it's popped
+    Conflict_List conflicts;
+    Conflict_List semicard_conflicts;
+    Conflict_List cardinal_conflicts;
+    Conflict_List unclassified_conflicts;//the conflicts that are not classified yet in the lazy mode
+    Persistent_Array<Constraint_List> constraints;//constraints of all the agents, from the newest to the oldest
     CBS_Node(std::vector<Path> _paths = {}, CBS_Node* _parent = nullptr, Constraint _constraint = Constraint(), double _cost = 0,
              std::vector<int> _cons_num = {}, int _conflicts_num = 0, bool _look_for_cardinal = true, int total_cons_ = 0)
-        :paths(_paths), parent(_parent), constraint(_constraint), cost(_cost), cons_num(_cons_num), conflicts_num(_conflicts_num), look_for_cardinal(_look_for_cardinal), total_cons(total_cons_)
+        :parent(_parent), constraint(_constraint), cost(_cost), cons_num(_cons_num), conflicts_num(_conflicts_num), look_for_cardinal(_look_for_cardinal), total_cons(total_cons_)
     {
         low_level_expanded = 0;
+        conflicts_memory = 0;
         conflicts = {};
         h = 0;
-        if(paths.size() == 1)
+        if(parent != nullptr)
+            paths = parent->paths;
+        for(auto& p: _paths)
+            if(p.agentID >= 0)//the path isn't found, so the node won't be added to the tree
+                paths.set(p.agentID, std::make_shared<const Path>(p));
+        if(_paths.size() == 1 && _paths[0].agentID >= 0)
         {
-            cons_num[paths[0].agentID]++;
+            cons_num[_paths[0].agentID]++;
             total_cons++;
         }
         cardinal_conflicts = {};
     }
-    ~CBS_Node()
+
+    std::size_t get_conflicts_memory() const
     {
-        parent = nullptr;
-        paths.clear();
-        conflicts.clear();
-        semicard_conflicts.clear();
-        cardinal_conflicts.clear();
+        std::size_t memory(0);
+        for(auto list: {&conflicts, &semicard_conflicts, &cardinal_conflicts, &unclassified_conflicts})
+            for(auto& c: *list)
+            {
+                memory += sizeof(std::shared_ptr<const Conflict>);
+                if(c.use_count() == 1)
+                    memory += sizeof(Conflict) + (c->path1 ? c->path1->nodes.capacity()*sizeof(Node) : 0) + (c->path2 ? c->path2->nodes.capacity()*sizeof(Node) : 0);
+            }
+        return memory;
     }
 
+    std::size_t get_memory() const //estimation of the memory that isn't shared with the parent
+    {
+        std::size_t memory = sizeof(CBS_Node) + id_str.capacity() + cons_num.capacity()*sizeof(int) + conflicts_memory;
+        memory += paths.get_memory() + constraints.get_memory();
+        if(parent == nullptr)
+        {
+            for(unsigned int i = 0; i < paths.size(); i++)
+                memory += sizeof(Path) + paths[i]->nodes.capacity()*sizeof(Node);
+        }
+        else
+            memory += sizeof(Path) + paths[constraint.agent]->nodes.capacity()*sizeof(Node) + sizeof(Constraint_Cell);
+        return memory;
+    }
+
+    void inherit_constraints(const CBS_Node &parent)
+    {
+        constraints = parent.constraints;
+        if(positive_constraint.agent >= 0)
+            constraints.set(positive_constraint.agent, std::make_shared<const Constraint_Cell>(positive_constraint, constraints[positive_constraint.agent]));
+        constraints.set(constraint.agent, std::make_shared<const Constraint_Cell>(constraint, constraints[constraint.agent]));
+    }
 };
 
 struct Open_Elem
@@ -251,16 +313,196 @@ typedef multi_index_container<
         >
 > Open_List;
 
+struct Visited_Elem
+{
+    double g;
+    bool closed;
+    int index;//position of the node in the list of expanded ones, if it's closed
+    unsigned int stamp;
+    Visited_Elem(double _g = -1, bool _closed = false, unsigned int _stamp = 0):g(_g), closed(_closed), index(-1), stamp(_stamp) {}
+};
+
+class Visited_Table //flat table of states keyed by (node, interval) pairs; an element is valid only if its stamp matches the current generation, so clearing is O(1)
+{
+    std::vector<Visited_Elem> table;
+    unsigned int generation;
+public:
+    Visited_Table() { generation = 1; }
+    void clear()
+    {
+        generation++;
+        if(generation == 0) //stamps have wrapped around, so old elements have to be invalidated explicitly
+        {
+            std::fill(table.begin(), table.end(), Visited_Elem());
+            generation = 1;
+        }
+    }
+    Visited_Elem* find(int key)
+    {
+        if(key < int(table.size()) && table[key].stamp == generation)
+            return &table[key];
+        return nullptr;
+    }
+    bool insert(int key, double g) //returns false if the key is already presented in the table
+    {
+        if(key >= int(table.size()))
+            table.resize(std::max(key + 1, int(table.size())*2));
+        if(table[key].stamp == generation)
+            return false;
+        table[key] = Visited_Elem(g, false, generation);
+        return true;
+    }
+};
+
+class Node_Arena //stores expanded nodes in fixed-size blocks, so pointers to them stay valid until the arena is cleared; memory is reused between searches
+{
+    std::vector<std::unique_ptr<Node[]>> blocks;
+    unsigned int count;
+    static const unsigned int block_size = 1024;
+public:
+    Node_Arena() { count = 0; }
+    unsigned int size() const { return count; }
+    void clear() { count = 0; }
+    Node& operator[](unsigned int k) { return blocks[k/block_size][k%block_size]; }
+    Node* add(const Node& node)
+    {
+        if(count == blocks.size()*block_size)
+            blocks.emplace_back(new Node[block_size]);
+        Node* pointer = &blocks[count/block_size][count%block_size];
+        *pointer = node;
+        count++;
+        return pointer;
+    }
+};
+
+struct SIPP_Record //result of a low-level search together with the constraints it was made with; used to repair the search after new constraints are added
+{
+    std::unordered_map<int, std::vector<std::pair<double, double>>> collision_intervals;
+    std::unordered_map<int, std::vector<std::pair<double, double>>> move_constraints;
+    std::vector<Node> nodes;//expanded nodes in the order of expansion
+    std::vector<int> parents;//positions of their parents in nodes, -1 for the start
+};
+
+class Open_Heap //indexed binary heap used as an open list of SIPP; nodes are ordered by f-value, ties are broken in favor of larger g-values
+{
+    struct Heap_Elem
+    {
+        Node node;
+        int key;
+        unsigned int seq;
+        Heap_Elem(Node _node = Node(), int _key = -1, unsigned int _seq = 0):node(_node), key(_key), seq(_seq) {}
+    };
+    std::vector<Heap_Elem> heap;
+    std::vector<int> positions;//position of each key in the heap, -1 if the key is not in the heap
+    unsigned int seq;
+    int pushes;
+    int pops;
+
+    bool before(const Heap_Elem& a, const Heap_Elem& b) const
+    {
+        if(fabs(a.node.f - b.node.f) > CN_EPSILON)
+            return a.node.f < b.node.f;
+        if(fabs(a.node.g - b.node.g) > CN_EPSILON)
+            return a.node.g > b.node.g;
+        return a.seq > b.seq; //the most recently added node goes first
+    }
+    void place(unsigned int pos, const Heap_Elem& elem)
+    {
+        heap[pos] = elem;
+        positions[elem.key] = pos;
+    }
+    void sift_up(unsigned int pos)
+    {
+        Heap_Elem elem = heap[pos];
+        while(pos > 0)
+        {
+            unsigned int parent = (pos - 1)/2;
+            if(!before(elem, heap[parent]))
+                break;
+            place(pos, heap[parent]);
+            pos = parent;
+        }
+        place(pos, elem);
+    }
+    void sift_down(unsigned int pos)
+    {
+        Heap_Elem elem = heap[pos];
+        unsigned int size = heap.size();
+        while(2*pos + 1 < size)
+        {
+            unsigned int child = 2*pos + 1;
+            if(child + 1 < size && before(heap[child + 1], heap[child]))
+                child++;
+            if(!before(heap[child], elem))
+                break;
+            place(pos, heap[child]);
+            pos = child;
+        }
+        place(pos, elem);
+    }
+public:
+    Open_Heap() { seq = 0; pushes = 0; pops = 0; }
+    bool empty() const { return heap.empty(); }
+    unsigned int size() const { return heap.size(); }
+    int get_pushes() const { return pushes; }
+    int get_pops() const { return pops; }
+    void reset_stats() { pushes = 0; pops = 0; }
+    void clear()
+    {
+        for(auto& elem: heap)
+            positions[elem.key] = -1;
+        heap.clear();
+        seq = 0;
+    }
+    bool contains(int key) const { return key < int(positions.size()) && positions[key] >= 0; }
+
+    void push(const Node& node, int key) //adds a node or replaces the one with the same key, i.e. decreases its key
+    {
+        pushes++;
+        if(key >= int(positions.size()))
+            positions.resize(key + 1, -1);
+        if(positions[key] < 0)
+        {
+            heap.push_back(Heap_Elem(node, key, seq++));
+            sift_up(heap.size() - 1);
+        }
+        else
+        {
+            unsigned int pos = positions[key];
+            heap[pos] = Heap_Elem(node, key, seq++);
+            sift_up(pos);
+            sift_down(positions[key]);
+        }
+    }
+
+    Node pop()
+    {
+        pops++;
+        Node min = heap[0].node;
+        positions[heap[0].key] = -1;
+        if(heap.size() > 1)
+        {
+            heap[0] = heap.back();
+            heap.pop_back();
+            sift_down(0);
+        }
+        else
+            heap.pop_back();
+        return min;
+    }
+};
+
 class CBS_Tree
 {
-    std::list<CBS_Node> tree;
+    std::deque<CBS_Node> tree;//never removes nodes, so the addresses stay valid
+    std::size_t memory;
     Focal_container focal;
     CT_container container;
     double focal_weight;
     int open_size;
     std::set<int> closed;
 public:
-    CBS_Tree() { open_size = 0; focal_weight = 1.0; }
+    CBS_Tree() { open_size = 0; focal_weight = 1.0; memory = 0; }
     unsigned int get_size()
     {
         return tree.size();
@@ -276,9 +518,24 @@ public:
         return open_size;
     }
 
-    void add_node(CBS_Node node)
+    double get_min_cost()
+    {
+        if(container.empty())
+            return CN_INFINITY;
+        return container.get<0>().begin()->cost;
+    }
+
+    double get_memory_per_node()
+    {
+        return double(memory)/std::max(tree.size(), std::size_t(1));
+    }
+
+    void add_node(CBS_Node&& new_node)
     {
-        tree.push_back(node);
+        tree.push_back(std::move(new_node));
+        CBS_Node &node = tree.back();
+        node.conflicts_memory = node.get_conflicts_memory();
+        memory += node.get_memory();
         container.insert(Open_Elem(&tree.back(), node.id, node.cost, node.f, node.total_cons, node.conflicts_num));
         open_size++;
         if(focal_weight > 1.0)
@@ -286,6 +543,27 @@ public:
                 focal.insert(Focal_Elem(node.id, node.conflicts_num, node.total_cons, node.cost));
     }
 
+    CBS_Node* pop_front(CBS_Node &node)
+    {
+        //the conflicts are moved to the popped copy, as the tree doesn't need them anymore
+        auto pointer = get_front();
+        memory -= pointer->conflicts_memory;
+        auto conflicts = std::move(pointer->conflicts);
+        auto semicard_conflicts = std::move(pointer->semicard_conflicts);
+        auto cardinal_conflicts = std::move(pointer->cardinal_conflicts);
+        auto unclassified_conflicts = std::move(pointer->unclassified_conflicts);
+        pointer->conflicts.clear();
+        pointer->semicard_conflicts.clear();
+        pointer->cardinal_conflicts.clear();
+        pointer->unclassified_conflicts.clear();
+        node = *pointer;
+        node.conflicts = std::move(conflicts);
+        node.semicard_conflicts = std::move(semicard_conflicts);
+        node.cardinal_conflicts = std::move(cardinal_conflicts);
+        node.unclassified_conflicts = std::move(unclassified_conflicts);
+        return pointer;
+    }
+
     CBS_Node* get_front()
     {
         open_size--;
@@ -320,23 +598,42 @@ public:
             focal.insert(Focal_Elem(it->id, it->conflicts_num, it->cons_num, it->cost));
     }
 
-    std::vector<Path> get_paths(CBS_Node node, int size)
+    std::vector<Path> get_paths(const CBS_Node &node, int size)
     {
         std::vector<Path> paths(size);
-        while(node.parent != nullptr)
-        {
-            if(paths.at(node.paths.begin()->agentID).nodes.empty())
-                paths.at(node.paths.begin()->agentID) = *node.paths.begin();
-            node = *node.parent;
-        }
-        for(unsigned int i = 0; i < node.paths.size(); i++)
-            if(paths.at(i).nodes.empty())
-                paths.at(i) = node.paths.at(i);
+        for(int i = 0; i < size; i++)
+            paths[i] = *node.paths[i];
         return paths;
     }
 
 };
 
+struct HL_Stats //counters of the high-level search; each thread keeps its own ones in the parallel mode
+{
+    int expanded;
+    int low_level_searches;
+    int low_level_expanded;
+    int cardinal_solved;
+    int semicardinal_solved;
+    double low_level_pushed;
+    double low_level_popped;
+    double check_time;
+    HL_Stats():expanded(0), low_level_searches(0), low_level_expanded(0), cardinal_solved(0), semicardinal_solved(0),
+        low_level_pushed(0), low_level_popped(0), check_time(0) {}
+    HL_Stats& operator +=(const HL_Stats& other)
+    {
+        expanded += other.expanded;
+        low_level_searches += other.low_level_searches;
+        low_level_expanded += other.low_level_expanded;
+        cardinal_solved += other.cardinal_solved;
+        semicardinal_solved += other.semicardinal_solved;
+        low_level_pushed += other.low_level_pushed;
+        low_level_popped += other.low_level_popped;
+        check_time += other.check_time;
+        return *this;
+    }
+};
+
 struct Solution
 {
     double flowtime;
@@ -349,13 +646,19 @@ struct Solution
     int high_level_generated;
     int low_level_expansions;
     double low_level_expanded;
+    double low_level_pushed;
+    double low_level_popped;
+    double cache_hit_rate;
+    double memory_per_node;
     int cardinal_solved;
     int semicardinal_solved;
     std::chrono::duration<double> time;
     std::chrono::duration<double> init_time;
     std::vector<Path> paths;
+    bool found;
+    std::string config;//the configuration that has found the solution in the portfolio mode
     Solution(double _flowtime = -1, double _makespan = -1, std::vector<Path> _paths = {})
-        : flowtime(_flowtime), makespan(_makespan), paths(_paths) { init_cost = -1; constraints_num = 0; low_level_expanded = 0; low_level_expansions = 0; cardinal_solved = 0; semicardinal_solved = 0; max_constraints = 0;}
+        : flowtime(_flowtime), makespan(_makespan), paths(_paths) { init_cost = -1; constraints_num = 0; low_level_expanded = 0; low_level_pushed = 0; low_level_popped = 0; cache_hit_rate = 0; memory_per_node = 0; found = false; low_level_expansions = 0; cardinal_solved = 0; semicardinal_solved = 0; max_constraints = 0;}
     ~Solution() { paths.clear(); }
 };
 
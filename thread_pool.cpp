@@ -0,0 +1,72 @@
+#include "thread_pool.h"
+
+Thread_Pool::~Thread_Pool()
+{
+    shutdown();
+}
+
+void Thread_Pool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    start_cv.notify_all();
+    for(auto& w: workers)
+        w.join();
+    workers.clear();
+    stop = false;
+}
+
+void Thread_Pool::init(int threads)
+{
+    if(threads == get_size())
+        return;
+    shutdown();
+    for(int i = 1; i < threads; i++)
+        workers.emplace_back(&Thread_Pool::work, this, i);
+}
+
+void Thread_Pool::run(int tasks, std::function<void(int, int)> task)
+{
+    if(workers.empty() || tasks < 2)
+    {
+        for(int k = 0; k < tasks; k++)
+            task(k, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = task;
+        tasks_num = tasks;
+        next_task = 0;
+        active = int(workers.size());
+        generation++;
+    }
+    start_cv.notify_all();
+    for(int k = next_task++; k < tasks; k = next_task++)
+        job(k, 0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]{ return active == 0; });
+    job = nullptr;
+}
+
+void Thread_Pool::work(int thread_id)
+{
+    unsigned int done_generation(0);
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [&]{ return stop || generation != done_generation; });
+        if(stop)
+            return;
+        done_generation = generation;
+        int tasks = tasks_num;
+        lock.unlock();
+        for(int k = next_task++; k < tasks; k = next_task++)
+            job(k, thread_id);
+        lock.lock();
+        if(--active == 0)
+            done_cv.notify_one();
+    }
+}
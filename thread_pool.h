@@ -0,0 +1,32 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Thread_Pool //fixed set of workers; the calling thread takes part in each job as the thread 0
+{
+public:
+    Thread_Pool():tasks_num(0), next_task(0), active(0), generation(0), stop(false) {}
+    ~Thread_Pool();
+    void init(int threads);
+    int get_size() const { return int(workers.size()) + 1; }
+    void run(int tasks, std::function<void(int, int)> task);//calls task(task_id, thread_id) for all the tasks and waits for them to finish
+private:
+    void work(int thread_id);
+    void shutdown();
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv, done_cv;
+    std::function<void(int, int)> job;
+    int tasks_num;
+    std::atomic<int> next_task;
+    int active;//workers that haven't finished the current job yet
+    unsigned int generation;
+    bool stop;
+};
+
+#endif // THREAD_POOL_H
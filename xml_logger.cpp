@@ -57,6 +57,8 @@ void XML_logger::write_to_log_summary(const Solution &solution)
     element->SetAttribute(CNS_TAG_ATTR_TIME, solution.time.count());
     element->SetAttribute(CNS_TAG_ATTR_FLOWTIME, solution.flowtime);
     element->SetAttribute(CNS_TAG_ATTR_MAKESPAN, solution.makespan);
+    if(!solution.config.empty())
+        element->SetAttribute(CNS_TAG_ATTR_CONFIG, solution.config.c_str());
 }
 
 void XML_logger::write_to_log_path(const Solution &solution)